@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "devices.h"
+
+/* Планировщик реле.
+ *
+ * Команды (actuator_request) только запоминают желаемое состояние и применяются
+ * сразу, если это позволяют ограничения по времени из device_timing. Всё
+ * остальное - отложенные команды, минимальные интервалы и автоотключение -
+ * обрабатывает actuator_tick() раз в ACTUATOR_TICK_MS, без отдельной задачи на реле.
+ *
+ * Состояние планировщика - в структуре actuator: у прошивки она одна, у хостового
+ * симулятора флота - своя у каждого виртуального контроллера. */
+
+#define ACTUATOR_TICK_MS 100
+
+// Переключает реле id. Вызывается под блокировкой планировщика, блокироваться не должна
+typedef void (*actuator_output)(void *ctx, int id, bool on);
+
+typedef struct {
+    const device_config *config;
+    bool on;            // Текущее состояние реле
+    bool desired;       // Последнее запрошенное состояние
+    int64_t changed_us; // Когда реле последний раз переключилось
+} actuator_slot;
+
+typedef struct {
+    actuator_slot slots[DEVICE_MAX];
+    int count;
+    uint8_t locked_groups;
+    actuator_output output;
+    void *ctx;
+    portMUX_TYPE lock; // Команды, тик и концевик приходят из разных задач; секции короткие
+} actuator;
+
+// Все реле считаются выключенными; выходы вызывающий настраивает сам
+esp_err_t actuator_init(actuator *relays, const device_config *devices, int count,
+                        actuator_output output, void *ctx);
+
+// Запускает периодический таймер, который вызывает actuator_tick() для relays
+esp_err_t actuator_start(actuator *relays);
+
+// Один проход планировщика на момент hal_time_us()
+void actuator_tick(actuator *relays);
+
+// Запрашивает состояние реле id; применяется сразу или на ближайшем тике, когда будет можно
+void actuator_request(actuator *relays, int id, bool on);
+
+// Блокировка группы (DEVICE_GROUP_*): сразу выключает её реле и держит их выключенными.
+// После снятия блокировки реле возвращаются в последнее запрошенное состояние.
+void actuator_lockout(actuator *relays, uint8_t group, bool locked);
+
+bool actuator_is_on(const actuator *relays, int id);
+
+// Последние запрошенные состояния всех реле, бит i - устройство i
+uint32_t actuator_desired_mask(actuator *relays);
@@ -0,0 +1,13 @@
+#pragma once
+
+/* Тайминги и стеки контроллера. Прошивка и хостовые тесты берут их отсюда,
+ * чтобы тесты проверяли те же значения, с которыми работает плата. */
+
+#define LIMIT_DEBOUNCE_MS 20 // Столько мс без единого фронта, чтобы уровень считался устойчивым
+
+#define LONG_POLL_WAIT_S   30
+#define POLL_PERIOD_MS     1000
+#define RELAY_SNAPSHOT_PERIOD_MS 1000 // Как часто проверять, не пора ли переписать снимок
+
+#define DEVICES_TASK_STACK      4096
+#define LIMIT_SWITCH_TASK_STACK 2048
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Таблица устройств контроллера. Новое реле - это одна строка в devices.c:
+ * ни своей задачи, ни своего буфера ему не нужно. Устройство везде определяется
+ * индексом в g_devices. */
+
+// Слоты планировщика и счётчики метрик выделены статически на DEVICE_MAX устройств:
+// новое устройство стоит строку таблицы во флеше, а RAM растёт только вместе с DEVICE_MAX
+// Замер хост-сборки (x86_64, -Os, size по объектам приложения): +1 строка таблицы -
+// +32 байта .data.rel.ro и +7 байт имени, RAM не меняется; +1 к DEVICE_MAX - +24 байта .bss.
+// На ESP32 (idf.py size-components, libmain.a) ещё не замерено
+#define DEVICE_MAX 16
+
+#define LIMIT_SWITCH_PIN 5 // Пин для концевика
+#define LIMIT_SWITCH_ACTIVE_LEVEL 0 // Концевик замыкает пин на землю (подтяжка к питанию)
+
+// Группы блокировок: реле выключается, пока заблокирована любая из его групп
+#define DEVICE_GROUP_LIMIT_SWITCH (1 << 0)
+
+typedef struct {
+    uint32_t min_on_ms;   // Не выключать раньше, чем через столько после включения
+    uint32_t min_off_ms;  // Не включать раньше, чем через столько после выключения
+    uint32_t auto_off_ms; // Выключить само через столько после включения, 0 - никогда
+} device_timing;
+
+typedef struct {
+    const char *id;        // Имя устройства в ответе сервера
+    int pin;
+    uint8_t safety_groups; // DEVICE_GROUP_*
+    device_timing timing;
+} device_config;
+
+extern const device_config g_devices[];
+extern const int g_device_count;
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "state_parser.h"
+
+/* Клиент сервера устройств: цикл GET /devices с ETag, long-poll и откатом на опрос.
+ *
+ * Ответ сервера на GET /devices - по строке на устройство (разбирает state_parser.c):
+ *   fan=1
+ *   humidifier=0
+ *   freshener=1
+ *   freshener2=0
+ * Вместе с ответом сервер отдаёт ETag; пока состояние не изменилось, на запрос
+ * с If-None-Match он отвечает 304 без тела.
+ *
+ * В режиме push клиент запрашивает GET /devices?wait=N: сервер не отвечает,
+ * пока состояние не отличается от If-None-Match, и через N секунд отдаёт 304.
+ * Если сервер так не умеет (отвечает 304 сразу или ошибкой 4xx), клиент
+ * возвращается к опросу раз в poll_period_ms и периодически пробует push снова.
+ *
+ * Клиент ничего не знает о реле: в on_states отдаются устройства, чьё состояние на
+ * сервере изменилось. Повтор того же значения в следующем ответе - не команда: иначе
+ * любой ответ заново включал бы освежитель, выключенный автоотключением.
+ * Прошивка запускает один клиент, хостовый симулятор флота (sim_fleet.c) - по
+ * одному на виртуальный контроллер. */
+
+#define DEVICES_CLIENT_ETAG_SIZE 64
+#define DEVICES_CLIENT_URL_SIZE  128
+
+// Вызывается из задачи клиента на каждый ответ с телом. changed - устройства, которые сервер
+// прислал впервые или с другим значением; values - их состояния, бит i - устройство i
+typedef void (*devices_client_states_cb)(void *ctx, uint32_t changed, uint32_t values);
+
+typedef struct {
+    const char *url;           // Адрес GET /devices
+    bool push;                 // Пробовать long-poll; false - только опрос
+    uint32_t long_poll_wait_s;
+    uint32_t poll_period_ms;
+    uint32_t jitter_ms;        // Случайная добавка к паузам, чтобы контроллеры не ходили на сервер разом
+    uint32_t stats_period_ms;  // Как часто печатать статистику; 0 - не печатать
+    bool metrics;              // Учитывать запросы в metrics.c (только у клиента прошивки)
+    devices_client_states_cb on_states;
+    void *ctx;
+} devices_client_config;
+
+typedef struct {
+    devices_client_config config;
+    state_parser parser;                         // Разбирает тело прямо из кусков HTTP-ответа
+    char etag[DEVICES_CLIENT_ETAG_SIZE];         // ETag последнего применённого состояния
+    char pending_etag[DEVICES_CLIENT_ETAG_SIZE]; // ETag из заголовков текущего ответа
+    char long_poll_url[DEVICES_CLIENT_URL_SIZE];
+    uint32_t server_seen;   // Устройства, о которых сервер уже сообщал; до запуска задачи можно
+    uint32_t server_values; // заполнить из снимка, чтобы после перезагрузки повтор не был командой
+} devices_client;
+
+// Тело задачи FreeRTOS, pvParameters - devices_client с заполненным config. Не возвращается
+void devices_client_task(void *pvParameters);
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/* Слой абстракции железа: GPIO, HTTP-клиент, Wi-Fi, энергонезависимая память и время.
+ *
+ * hal_esp32.c - реализация на ESP-IDF для платы.
+ * hal_linux.c - сборка под хост (idf.py --preview set-target linux): реле,
+ * концевик и сервер устройств симулируются в процессе, а управляющий цикл
+ * прошивки работает без изменений и печатает замеры производительности.
+ * Рядом с ним могут работать виртуальные контроллеры (sim_fleet.c).
+ *
+ * FreeRTOS есть в обеих сборках, поэтому задачи и уведомления используются напрямую. */
+
+typedef void (*hal_edge_cb)(void *arg);
+typedef void (*hal_timer_cb)(void *arg);
+
+typedef struct {
+    void (*on_header)(void *ctx, const char *key, const char *value);
+    void (*on_data)(void *ctx, const char *data, int len);
+    void *ctx;
+} hal_http_handlers;
+
+typedef struct hal_http_client *hal_http_handle;
+
+// Пишет кусок ответа локального HTTP-сервера
+typedef void (*hal_http_write)(void *out, const char *text, int len);
+typedef void (*hal_http_render)(hal_http_write write, void *out);
+
+// NVS, сетевой стек и цикл событий
+void hal_init(void);
+
+// Можно вызывать из прерывания
+int64_t hal_time_us(void);
+esp_err_t hal_timer_start_periodic(hal_timer_cb cb, void *arg, uint32_t period_ms, const char *name);
+uint32_t hal_min_free_heap(void);
+uint32_t hal_random(void);
+
+// Выход на реле, изначально выключен
+void hal_output_init(int pin);
+void hal_output_set(int pin, bool on);
+
+// Вход с подтяжкой к питанию; on_edge вызывается из прерывания на любом фронте.
+// Прерывание работает и во время записи во флеш, поэтому on_edge должна быть IRAM_ATTR
+void hal_input_init(int pin, hal_edge_cb on_edge, void *arg);
+// Можно вызывать из прерывания
+void hal_input_edge_enable(int pin, bool enable);
+int hal_input_get(int pin);
+
+// Небольшие данные, переживающие перезагрузку (NVS на плате). Размер должен совпадать точно
+esp_err_t hal_storage_get(const char *key, void *data, size_t len);
+esp_err_t hal_storage_set(const char *key, const void *data, size_t len);
+
+// Запускает подключение к точке доступа и сразу возвращается. Канал и BSSID последней
+// точки берутся из NVS; при обрыве переподключается бесконечно с экспоненциальной задержкой
+void hal_wifi_start(const char *ssid, const char *password);
+// Ждёт подключения не дольше timeout_ms; true, если подключены
+bool hal_wifi_wait_connected(uint32_t timeout_ms);
+// Уровень сигнала точки доступа; ESP_ERR_INVALID_STATE, если не подключены
+esp_err_t hal_wifi_rssi(int8_t *rssi);
+// Сколько раз связь с точкой доступа пропадала
+uint32_t hal_wifi_reconnects(void);
+
+// Один клиент на всё время работы, соединение переиспользуется между запросами.
+// В хостовой сборке запрос - прямой вызов заглушки сервера в процессе: сокетов,
+// keep-alive и разбора HTTP там нет, проверяются только протокол и куски тела
+hal_http_handle hal_http_open(const char *url, const hal_http_handlers *handlers);
+// GET url; if_none_match может быть NULL. В status - код ответа HTTP
+esp_err_t hal_http_get(hal_http_handle client, const char *url, const char *if_none_match,
+                       int timeout_ms, int *status);
+
+// Локальный HTTP-сервер на плате: GET uri отдаёт text/plain, написанный render
+esp_err_t hal_http_serve(const char *uri, hal_http_render render);
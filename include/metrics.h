@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "actuator.h"
+
+/* Метрики контроллера в формате Prometheus на GET /metrics.
+ *
+ * Запись - только атомарные инкременты счётчиков без блокировок, её можно
+ * вызывать из управляющего цикла и из критических секций планировщика.
+ * Вся работа (форматирование, статистика задач, RSSI) делается при запросе /metrics. */
+
+typedef enum {
+    METRICS_MODE_POLL,
+    METRICS_MODE_PUSH,
+    METRICS_MODE_COUNT
+} metrics_mode;
+
+typedef enum {
+    METRICS_RESULT_OK,
+    METRICS_RESULT_NOT_MODIFIED,
+    METRICS_RESULT_ERROR,
+    METRICS_RESULT_MALFORMED,
+    METRICS_RESULT_COUNT
+} metrics_result;
+
+// duration_ms в режиме опроса - время ответа, в push - сколько сервер держал запрос
+void metrics_record_request(metrics_mode mode, metrics_result result, uint32_t duration_ms);
+void metrics_record_toggle(int device);
+void metrics_record_limit_trip(void);
+
+// Регистрирует /metrics на локальном HTTP-сервере; состояния реле берутся из relays
+esp_err_t metrics_start(const actuator *relays);
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hal.h"
+
+/* Симулятор хостовой сборки (CONFIG_IDF_TARGET_LINUX): заглушка сервера устройств
+ * в hal_linux.c и флот виртуальных контроллеров в sim_fleet.c.
+ *
+ * У заглушки сервера по комнате на контроллер, у каждой комнаты свои состояния
+ * устройств и свой ETag. Комната 0 - сама прошивка (app_main), её адрес любой
+ * без /rooms/; виртуальный контроллер n ходит на SIM_SERVER_URL "/rooms/<n>/devices". */
+
+#define SIM_SERVER_URL "http://sim"
+
+typedef struct {
+    uint32_t requests;     // Ответы комнаты, включая 304
+    uint32_t not_modified; // 304 без тела
+    uint32_t bodies;       // 200 с состояниями устройств
+} sim_room_stats;
+
+typedef struct {
+    uint64_t allocs;       // Выделений памяти с запуска
+    int64_t used;          // Байт занято сейчас
+    int64_t peak;          // Пик занятого с прошлого sim_heap_stats()
+} sim_heap;
+
+typedef struct {
+    int number;                 // 0 - первый запуск, дальше - номер перезагрузки (SIM_BOOT)
+    int64_t actuated_us;        // От старта до первого реле в состоянии "сервера", -1 - ещё нет
+    bool from_snapshot;         // Первое реле включилось до Wi-Fi, по снимку из NVS
+    int64_t wifi_ms;            // От старта до подключения к Wi-Fi, 0 - ещё нет
+    bool wifi_cached;           // ...к точке доступа из кэша, без полного сканирования
+    uint32_t reconnects;
+    int64_t last_reconnect_ms;  // От обрыва до подключения
+    bool last_reconnect_cached;
+} sim_boot;
+
+typedef struct {
+    uint32_t commands;          // Команд "сервера", дошедших до реле
+    int64_t propagation_p50_us; // От команды на сервере до реле
+    int64_t propagation_p99_us;
+    int64_t propagation_max_us;
+    uint64_t cycles;            // Проходов управляющего цикла (между HTTP-запросами)
+    uint64_t cycle_cpu_ns;      // CPU потока на проход вместе с разбором ответа, в среднем
+    double cycle_allocs;        // Выделений памяти на проход, в среднем
+} sim_stats;
+
+// Целое из переменной окружения name (можно 0x...) или fallback, если её нет
+int sim_env(const char *name, int fallback);
+
+// Реле устройства device в комнате room перешло в состояние on; замеряет задержку команды
+void sim_relay_changed(int room, int device, bool on);
+
+// Уровень на входе pin; при включённом прерывании обработчик фронта вызывается сразу,
+// в потоке вызывающего, как из ISR
+void sim_input_set(int pin, int level);
+
+// Состояние выхода pin и время его последнего переключения (hal_time_us)
+bool sim_output_get(int pin);
+int64_t sim_output_changed_us(int pin);
+
+// Команда "сервера": устройство device в комнате room должно перейти в состояние on
+void sim_server_command(int room, int device, bool on);
+
+// etag = false: комната отвечает как сервер без кеширования - без ETag, не глядя на
+// If-None-Match и ?wait=N, сразу и всегда с телом
+void sim_server_room_etag(int room, bool etag);
+
+// Счётчики ответов комнаты room с запуска
+void sim_server_room_stats(int room, sim_room_stats *stats);
+
+// Замеры управляющего цикла с прошлого вызова (или отчёта sim_driver); начинает их заново
+void sim_stats_take(sim_stats *stats);
+
+// Куча всего процесса; пик после вызова начинается заново с текущего занятого
+void sim_heap_stats(sim_heap *heap);
+
+// Страница, зарегистрированная через hal_http_serve(), как на GET; ESP_ERR_NOT_FOUND - её нет
+esp_err_t sim_http_render(hal_http_write write, void *out);
+
+// Сдвигает hal_time_us() вперёд на us; задержки FreeRTOS идут по-прежнему в реальном времени
+void sim_clock_advance(int64_t us);
+
+// Перезагрузка: тот же исполняемый файл с теми же аргументами заново, с SIM_BOOT на 1 больше.
+// NVS остаётся в SIM_NVS_PATH, комната 0 "сервера" - в SIM_SERVER_STATE. Возвращается, только если exec не удался
+void sim_reboot(void);
+
+// Загрузка и переподключения Wi-Fi с запуска процесса
+void sim_boot_stats(sim_boot *boot);
+
+// Рвёт симулированный Wi-Fi; точка доступа вернётся через outage_ms
+void sim_wifi_drop(uint32_t outage_ms);
+
+// Запускает count виртуальных контроллеров для комнат 1..count
+void sim_fleet_start(int count);
+
+// Концевик виртуального контроллера комнаты room
+void sim_fleet_limit_switch(int room, bool tripped);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "devices.h"
+
+/* Потоковый разбор ответа GET /devices ("имя=0|1" по строке на устройство).
+ *
+ * Куски тела подаются в state_parser_feed() прямо из HTTP-клиента, как пришли:
+ * граница куска может оказаться где угодно. Имя не копируется - по мере чтения
+ * отсекаются не подходящие строки таблицы g_devices. Память постоянная, кучи нет.
+ *
+ * Команды копятся в масках и применяются вызывающим только после
+ * state_parser_finish(), так что испорченный ответ не применяется даже частично.
+ * Неизвестные имена устройств пропускаются: сервер может знать больше устройств. */
+
+_Static_assert(DEVICE_MAX <= 32, "state_parser keeps devices in 32-bit masks");
+
+typedef struct {
+    uint8_t state;
+    uint8_t name_len;
+    uint32_t candidates; // Устройства, чьё имя начинается с уже прочитанного
+    uint32_t seen;       // Устройства, для которых в ответе есть состояние
+    uint32_t values;     // Их состояния
+} state_parser;
+
+void state_parser_reset(state_parser *parser);
+
+// ESP_ERR_INVALID_RESPONSE, если ответ испорчен; дальнейшие куски игнорируются
+esp_err_t state_parser_feed(state_parser *parser, const char *data, int len);
+
+// Проверяет, что ответ не оборвался посреди строки
+esp_err_t state_parser_finish(state_parser *parser);
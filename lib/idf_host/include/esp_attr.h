@@ -0,0 +1,5 @@
+#pragma once
+
+// На хосте нет IRAM: код из прерывания - обычная функция
+#define IRAM_ATTR
+#define DRAM_ATTR
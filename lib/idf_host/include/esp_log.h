@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Формат как у ESP-IDF: "I (мс) TAG: сообщение". Уровень общий для всех тегов:
+ * esp_log_level_set() с любым тегом меняет его целиком. */
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+extern esp_log_level_t idf_host_log_level;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+uint32_t esp_log_timestamp(void);
+
+#define IDF_HOST_LOG(level, letter, tag, format, ...) do {                                  \
+        if (idf_host_log_level >= (level)) {                                                 \
+            printf(letter " (%u) %s: " format "\n", (unsigned) esp_log_timestamp(), tag,     \
+                   ##__VA_ARGS__);                                                           \
+        }                                                                                    \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) IDF_HOST_LOG(ESP_LOG_ERROR, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) IDF_HOST_LOG(ESP_LOG_WARN, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) IDF_HOST_LOG(ESP_LOG_INFO, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) IDF_HOST_LOG(ESP_LOG_DEBUG, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) IDF_HOST_LOG(ESP_LOG_VERBOSE, "V", tag, format, ##__VA_ARGS__)
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+/* Подмножество FreeRTOS из ESP-IDF поверх pthread - ровно то, что нужно прошивке
+ * и тестам в env:native. Задачи - потоки с собственным стеком заданного размера
+ * (см. uxTaskGetStackHighWaterMark в task.h), тик - 1 мс монотонных часов.
+ * Критические секции - один общий рекурсивный мьютекс, как глобальная блокировка
+ * прерываний: вложенность и вызов из "прерывания" (обычного потока) допустимы. */
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+
+#define portMAX_DELAY      ((TickType_t) 0xffffffffUL)
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define portTICK_PERIOD_MS ((TickType_t) 1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)  ((TickType_t) (((uint64_t) (ms) * configTICK_RATE_HZ) / 1000))
+
+#if CONFIG_FREERTOS_RUN_TIME_COUNTER_TYPE_U64
+#define configRUN_TIME_COUNTER_TYPE uint64_t
+#else
+#define configRUN_TIME_COUNTER_TYPE uint32_t
+#endif
+
+#ifndef BIT0
+#define BIT0 (1UL << 0)
+#define BIT1 (1UL << 1)
+#define BIT2 (1UL << 2)
+#define BIT3 (1UL << 3)
+#endif
+
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portMUX_INITIALIZE(mux)      ((mux)->unused = 0)
+
+void idf_host_critical_enter(void);
+void idf_host_critical_exit(void);
+
+#define portENTER_CRITICAL(mux)     ((void) (mux), idf_host_critical_enter())
+#define portEXIT_CRITICAL(mux)      ((void) (mux), idf_host_critical_exit())
+#define portENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux)  portEXIT_CRITICAL(mux)
+
+#define portYIELD_FROM_ISR(woken) ((void) (woken))
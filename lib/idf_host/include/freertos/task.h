@@ -0,0 +1,61 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct idf_host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+typedef enum {
+    eRunning,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted,
+    eInvalid
+} eTaskState;
+
+typedef struct {
+    TaskHandle_t xHandle;
+    const char *pcTaskName;
+    UBaseType_t xTaskNumber;
+    eTaskState eCurrentState;
+    UBaseType_t uxCurrentPriority;
+    UBaseType_t uxBasePriority;
+    configRUN_TIME_COUNTER_TYPE ulRunTimeCounter; // Время CPU потока, мкс
+    void *pxStackBase;
+    uint32_t usStackHighWaterMark;
+} TaskStatus_t;
+
+#define configMAX_TASK_NAME_LEN 16
+
+// usStackDepth в байтах, как в ESP-IDF; приоритет на хосте не учитывается
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth,
+                       void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask);
+// Только vTaskDelete(NULL) - задача завершает сама себя
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+
+void vTaskDelay(TickType_t xTicksToDelay);
+void vTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement);
+TickType_t xTaskGetTickCount(void);
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+TaskHandle_t xTaskGetHandle(const char *pcNameToQuery);
+char *pcTaskGetName(TaskHandle_t xTaskToQuery);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken);
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+
+/* Стек задачи заполняется шаблоном при создании, отметка - сколько байт стека ниже
+ * тронутого шаблоном осталось, считая от входа в функцию задачи: TCB и TLS glibc
+ * лежат выше и не считаются, как TCB FreeRTOS. Код на хосте 64-битный и с glibc,
+ * стека ему нужно больше, поэтому стек задачи - IDF_HOST_STACK_SCALE заказанных, и
+ * отметка считается от него; ещё IDF_HOST_STACK_EXTRA - под TCB, TLS и запас. */
+#define IDF_HOST_STACK_SCALE 2
+#define IDF_HOST_STACK_EXTRA (64 * 1024)
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask);
+
+UBaseType_t uxTaskGetNumberOfTasks(void);
+// Счётчики в микросекундах: время CPU задачи и, в pulTotalRunTime, время с первого вызова FreeRTOS
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *pxTaskStatusArray, UBaseType_t uxArraySize,
+                                 configRUN_TIME_COUNTER_TYPE *pulTotalRunTime);
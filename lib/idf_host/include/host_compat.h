@@ -0,0 +1,11 @@
+#pragma once
+
+/* Подключается ко всем файлам env:native через -include (platformio.ini): то, что на
+ * плате даёт newlib, а на хосте есть не в каждой libc. */
+
+#include <string.h>
+
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+#define IDF_HOST_STRLCPY 1
+size_t strlcpy(char *dst, const char *src, size_t size);
+#endif
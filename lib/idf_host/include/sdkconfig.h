@@ -0,0 +1,10 @@
+#pragma once
+
+/* Конфигурация для env:native (platformio.ini): прошивка собирается как хостовая
+ * сборка ESP-IDF (hal_linux.c, sim_fleet.c), FreeRTOS - из idf_host на pthread. */
+
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_FREERTOS_USE_TRACE_FACILITY 1
+#define CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS 1
+#define CONFIG_FREERTOS_RUN_TIME_COUNTER_TYPE_U64 1
@@ -0,0 +1,416 @@
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+
+#define STACK_FILL 0xa5
+
+struct idf_host_task {
+    TaskFunction_t code;
+    void *arg;
+    char name[configMAX_TASK_NAME_LEN];
+    UBaseType_t number;
+    UBaseType_t priority;
+    uint32_t depth;       // Заказанный стек, байт
+    uint8_t *stack;       // NULL - поток создан не через xTaskCreate (например, main)
+    size_t stack_size;
+    uint8_t *entry_sp;    // Вершина стека при входе в функцию задачи: выше - TCB и TLS glibc
+    pthread_t thread;
+    bool deleted;
+    pthread_mutex_t notify_lock;
+    pthread_cond_t notify_cond;
+    uint32_t notify;
+    struct idf_host_task *next;
+};
+
+struct idf_host_event_group {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    EventBits_t bits;
+};
+
+struct idf_host_semaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    UBaseType_t count;
+    UBaseType_t max;
+};
+
+static pthread_mutex_t s_critical;
+static pthread_mutex_t s_tasks_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct idf_host_task *s_tasks;
+static UBaseType_t s_task_count;
+static struct timespec s_start;
+static __thread struct idf_host_task *t_current;
+
+__attribute__((constructor))
+static void idf_host_init(void) {
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&s_critical, &attr);
+    pthread_mutexattr_destroy(&attr);
+    clock_gettime(CLOCK_MONOTONIC, &s_start);
+}
+
+static void fatal(const char *what) {
+    fprintf(stderr, "idf_host: %s\n", what);
+    abort();
+}
+
+void idf_host_critical_enter(void) {
+    pthread_mutex_lock(&s_critical);
+}
+
+void idf_host_critical_exit(void) {
+    pthread_mutex_unlock(&s_critical);
+}
+
+static uint64_t since_start_us(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - s_start.tv_sec) * 1000000ULL + (now.tv_nsec - s_start.tv_nsec) / 1000;
+}
+
+// Момент через ticks от текущего по CLOCK_MONOTONIC
+static struct timespec deadline_after(TickType_t ticks) {
+    struct timespec deadline;
+    uint64_t ms = (uint64_t) ticks * portTICK_PERIOD_MS;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += (ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    return deadline;
+}
+
+static void cond_init(pthread_mutex_t *lock, pthread_cond_t *cond) {
+    pthread_condattr_t attr;
+
+    pthread_mutex_init(lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// Ждёт сигнала; false - вышел срок. Вызывается под lock
+static bool cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t ticks, const struct timespec *deadline) {
+    if (ticks == portMAX_DELAY) return pthread_cond_wait(cond, lock) == 0;
+    return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+static void task_register(struct idf_host_task *task) {
+    pthread_mutex_lock(&s_tasks_lock);
+    task->number = ++s_task_count;
+    task->next = s_tasks;
+    s_tasks = task;
+    pthread_mutex_unlock(&s_tasks_lock);
+}
+
+static struct idf_host_task *task_alloc(const char *name) {
+    struct idf_host_task *task = calloc(1, sizeof(*task));
+    if (!task) return NULL;
+
+    snprintf(task->name, sizeof(task->name), "%s", name);
+    cond_init(&task->notify_lock, &task->notify_cond);
+    return task;
+}
+
+// Поток, созданный не через xTaskCreate, получает описание задачи при первом обращении
+static struct idf_host_task *current_task(void) {
+    if (t_current) return t_current;
+
+    t_current = task_alloc("main");
+    if (!t_current) fatal("out of memory");
+    t_current->thread = pthread_self();
+    task_register(t_current);
+    return t_current;
+}
+
+static void *task_entry(void *arg) {
+    t_current = (struct idf_host_task *) arg;
+    t_current->entry_sp = __builtin_frame_address(0);
+    t_current->code(t_current->arg);
+
+    // В FreeRTOS задача не может просто вернуться
+    fprintf(stderr, "idf_host: task %s returned\n", t_current->name);
+    abort();
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth,
+                       void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask) {
+    struct idf_host_task *task = task_alloc(pcName);
+    pthread_attr_t attr;
+    size_t page = 4096;
+
+    if (!task) return pdFAIL;
+    task->code = pxTaskCode;
+    task->arg = pvParameters;
+    task->priority = uxPriority;
+    task->depth = usStackDepth;
+    task->stack_size = ((size_t) usStackDepth * IDF_HOST_STACK_SCALE + IDF_HOST_STACK_EXTRA + page - 1) / page * page;
+    task->stack = mmap(NULL, task->stack_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (task->stack == MAP_FAILED) {
+        free(task);
+        return pdFAIL;
+    }
+    memset(task->stack, STACK_FILL, task->stack_size);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, task->stack, task->stack_size);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    task_register(task);
+    if (pxCreatedTask) *pxCreatedTask = task;
+    int err = pthread_create(&task->thread, &attr, task_entry, task);
+    pthread_attr_destroy(&attr);
+    if (err) fatal("pthread_create failed");
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete) {
+    struct idf_host_task *task = current_task();
+
+    if (xTaskToDelete && xTaskToDelete != task) fatal("vTaskDelete of another task is not supported");
+    pthread_mutex_lock(&s_tasks_lock);
+    task->deleted = true;
+    pthread_mutex_unlock(&s_tasks_lock);
+    // Стек не освобождаем: поток ещё на нём
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) {
+    if (!xTicksToDelay) {
+        sched_yield();
+        return;
+    }
+
+    struct timespec deadline = deadline_after(xTicksToDelay);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {}
+}
+
+void vTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement) {
+    *pxPreviousWakeTime += xTimeIncrement;
+
+    uint64_t wake_ms = (uint64_t) *pxPreviousWakeTime * portTICK_PERIOD_MS;
+    struct timespec deadline = {
+        .tv_sec = s_start.tv_sec + wake_ms / 1000,
+        .tv_nsec = s_start.tv_nsec + (wake_ms % 1000) * 1000000,
+    };
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {}
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return since_start_us() / 1000 / portTICK_PERIOD_MS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return current_task();
+}
+
+TaskHandle_t xTaskGetHandle(const char *pcNameToQuery) {
+    struct idf_host_task *found = NULL;
+
+    pthread_mutex_lock(&s_tasks_lock);
+    for (struct idf_host_task *task = s_tasks; task && !found; task = task->next) {
+        if (!task->deleted && strncmp(task->name, pcNameToQuery, sizeof(task->name) - 1) == 0) found = task;
+    }
+    pthread_mutex_unlock(&s_tasks_lock);
+    return found;
+}
+
+char *pcTaskGetName(TaskHandle_t xTaskToQuery) {
+    return (xTaskToQuery ? xTaskToQuery : current_task())->name;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+    pthread_mutex_lock(&xTaskToNotify->notify_lock);
+    xTaskToNotify->notify++;
+    pthread_cond_signal(&xTaskToNotify->notify_cond);
+    pthread_mutex_unlock(&xTaskToNotify->notify_lock);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken) {
+    xTaskNotifyGive(xTaskToNotify);
+    if (pxHigherPriorityTaskWoken) *pxHigherPriorityTaskWoken = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+    struct idf_host_task *task = current_task();
+    struct timespec deadline = deadline_after(xTicksToWait == portMAX_DELAY ? 0 : xTicksToWait);
+    uint32_t value;
+
+    pthread_mutex_lock(&task->notify_lock);
+    while (!task->notify && xTicksToWait && cond_wait(&task->notify_cond, &task->notify_lock, xTicksToWait, &deadline)) {}
+    value = task->notify;
+    if (value) task->notify = xClearCountOnExit ? 0 : value - 1;
+    pthread_mutex_unlock(&task->notify_lock);
+    return value;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask) {
+    struct idf_host_task *task = xTask ? xTask : current_task();
+    size_t untouched = 0;
+
+    if (!task->stack || !task->entry_sp) return 0;
+    while (untouched < task->stack_size && task->stack[untouched] == STACK_FILL) untouched++;
+
+    size_t depth = (size_t) task->depth * IDF_HOST_STACK_SCALE;
+    size_t used = task->entry_sp - (task->stack + untouched);
+    return used < depth ? depth - used : 0;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void) {
+    UBaseType_t count = 0;
+
+    pthread_mutex_lock(&s_tasks_lock);
+    for (struct idf_host_task *task = s_tasks; task; task = task->next) count += !task->deleted;
+    pthread_mutex_unlock(&s_tasks_lock);
+    return count;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *pxTaskStatusArray, UBaseType_t uxArraySize,
+                                 configRUN_TIME_COUNTER_TYPE *pulTotalRunTime) {
+    UBaseType_t count = 0;
+
+    pthread_mutex_lock(&s_tasks_lock);
+    for (struct idf_host_task *task = s_tasks; task && count < uxArraySize; task = task->next) {
+        clockid_t clock;
+        struct timespec cpu = {0};
+
+        if (task->deleted) continue;
+        if (pthread_getcpuclockid(task->thread, &clock) == 0) clock_gettime(clock, &cpu);
+        pxTaskStatusArray[count++] = (TaskStatus_t) {
+            .xHandle = task,
+            .pcTaskName = task->name,
+            .xTaskNumber = task->number,
+            .eCurrentState = task == t_current ? eRunning : eBlocked,
+            .uxCurrentPriority = task->priority,
+            .uxBasePriority = task->priority,
+            .ulRunTimeCounter = cpu.tv_sec * 1000000ULL + cpu.tv_nsec / 1000,
+            .pxStackBase = task->stack,
+            .usStackHighWaterMark = uxTaskGetStackHighWaterMark(task),
+        };
+    }
+    pthread_mutex_unlock(&s_tasks_lock);
+    if (pulTotalRunTime) *pulTotalRunTime = since_start_us();
+    return count;
+}
+
+EventGroupHandle_t xEventGroupCreate(void) {
+    struct idf_host_event_group *group = calloc(1, sizeof(*group));
+    if (!group) return NULL;
+
+    cond_init(&group->lock, &group->cond);
+    return group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, EventBits_t uxBitsToSet) {
+    EventBits_t bits;
+
+    pthread_mutex_lock(&xEventGroup->lock);
+    bits = xEventGroup->bits |= uxBitsToSet;
+    pthread_cond_broadcast(&xEventGroup->cond);
+    pthread_mutex_unlock(&xEventGroup->lock);
+    return bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, EventBits_t uxBitsToClear) {
+    EventBits_t bits;
+
+    pthread_mutex_lock(&xEventGroup->lock);
+    bits = xEventGroup->bits;
+    xEventGroup->bits &= ~uxBitsToClear;
+    pthread_mutex_unlock(&xEventGroup->lock);
+    return bits;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup) {
+    EventBits_t bits;
+
+    pthread_mutex_lock(&xEventGroup->lock);
+    bits = xEventGroup->bits;
+    pthread_mutex_unlock(&xEventGroup->lock);
+    return bits;
+}
+
+static bool bits_ready(EventBits_t bits, EventBits_t wait_for, BaseType_t all) {
+    return all ? (bits & wait_for) == wait_for : (bits & wait_for) != 0;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, EventBits_t uxBitsToWaitFor,
+                                BaseType_t xClearOnExit, BaseType_t xWaitForAllBits, TickType_t xTicksToWait) {
+    struct timespec deadline = deadline_after(xTicksToWait == portMAX_DELAY ? 0 : xTicksToWait);
+    EventBits_t bits;
+
+    pthread_mutex_lock(&xEventGroup->lock);
+    while (!bits_ready(xEventGroup->bits, uxBitsToWaitFor, xWaitForAllBits) && xTicksToWait &&
+           cond_wait(&xEventGroup->cond, &xEventGroup->lock, xTicksToWait, &deadline)) {}
+    bits = xEventGroup->bits;
+    if (xClearOnExit && bits_ready(bits, uxBitsToWaitFor, xWaitForAllBits)) xEventGroup->bits &= ~uxBitsToWaitFor;
+    pthread_mutex_unlock(&xEventGroup->lock);
+    return bits;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount) {
+    struct idf_host_semaphore *semaphore = calloc(1, sizeof(*semaphore));
+    if (!semaphore) return NULL;
+
+    cond_init(&semaphore->lock, &semaphore->cond);
+    semaphore->count = uxInitialCount;
+    semaphore->max = uxMaxCount;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime) {
+    struct timespec deadline = deadline_after(xBlockTime == portMAX_DELAY ? 0 : xBlockTime);
+    BaseType_t taken;
+
+    pthread_mutex_lock(&xSemaphore->lock);
+    while (!xSemaphore->count && xBlockTime && cond_wait(&xSemaphore->cond, &xSemaphore->lock, xBlockTime, &deadline)) {}
+    taken = xSemaphore->count > 0;
+    if (taken) xSemaphore->count--;
+    pthread_mutex_unlock(&xSemaphore->lock);
+    return taken ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore) {
+    BaseType_t given;
+
+    pthread_mutex_lock(&xSemaphore->lock);
+    given = xSemaphore->count < xSemaphore->max;
+    if (given) {
+        xSemaphore->count++;
+        pthread_cond_signal(&xSemaphore->cond);
+    }
+    pthread_mutex_unlock(&xSemaphore->lock);
+    return given ? pdTRUE : pdFALSE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore) {
+    pthread_mutex_destroy(&xSemaphore->lock);
+    pthread_cond_destroy(&xSemaphore->cond);
+    free(xSemaphore);
+}
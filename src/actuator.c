@@ -0,0 +1,108 @@
+#include <limits.h>
+#include "actuator.h"
+#include "esp_log.h"
+#include "hal.h"
+
+static const char *TAG = "ACTUATOR";
+
+static void slot_set(actuator *relays, actuator_slot *slot, bool on, int64_t now_us) {
+    relays->output(relays->ctx, slot - relays->slots, on);
+    slot->on = on;
+    slot->changed_us = now_us;
+}
+
+static void slot_update(actuator *relays, actuator_slot *slot, int64_t now_us) {
+    const device_timing *timing = &slot->config->timing;
+    int64_t since_change_us = now_us - slot->changed_us;
+
+    if (slot->config->safety_groups & relays->locked_groups) return;
+
+    if (slot->on && timing->auto_off_ms && since_change_us >= timing->auto_off_ms * 1000LL) {
+        slot->desired = false;
+        slot_set(relays, slot, false, now_us);
+        return;
+    }
+
+    if (slot->desired == slot->on) return;
+
+    uint32_t min_ms = slot->on ? timing->min_on_ms : timing->min_off_ms;
+    if (since_change_us >= min_ms * 1000LL) slot_set(relays, slot, slot->desired, now_us);
+}
+
+static void actuator_timer(void *arg) {
+    actuator_tick((actuator *) arg);
+}
+
+esp_err_t actuator_init(actuator *relays, const device_config *devices, int count,
+                        actuator_output output, void *ctx) {
+    if (count > DEVICE_MAX) {
+        ESP_LOGE(TAG, "Too many devices: %d, max %d", count, DEVICE_MAX);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int i = 0; i < count; i++) {
+        relays->slots[i] = (actuator_slot) {
+            .config = &devices[i],
+            .changed_us = LLONG_MIN / 2 // Как будто переключалось давно
+        };
+    }
+    relays->count = count;
+    relays->locked_groups = 0;
+    relays->output = output;
+    relays->ctx = ctx;
+    portMUX_INITIALIZE(&relays->lock);
+    return ESP_OK;
+}
+
+esp_err_t actuator_start(actuator *relays) {
+    return hal_timer_start_periodic(actuator_timer, relays, ACTUATOR_TICK_MS, "actuator_tick");
+}
+
+void actuator_tick(actuator *relays) {
+    int64_t now_us = hal_time_us();
+
+    portENTER_CRITICAL(&relays->lock);
+    for (int i = 0; i < relays->count; i++) slot_update(relays, &relays->slots[i], now_us);
+    portEXIT_CRITICAL(&relays->lock);
+}
+
+void actuator_request(actuator *relays, int id, bool on) {
+    if (id < 0 || id >= relays->count) return;
+
+    portENTER_CRITICAL(&relays->lock);
+    relays->slots[id].desired = on;
+    slot_update(relays, &relays->slots[id], hal_time_us());
+    portEXIT_CRITICAL(&relays->lock);
+}
+
+void actuator_lockout(actuator *relays, uint8_t group, bool locked) {
+    int64_t now_us = hal_time_us();
+
+    portENTER_CRITICAL(&relays->lock);
+    if (locked) relays->locked_groups |= group;
+    else relays->locked_groups &= ~group;
+
+    for (int i = 0; i < relays->count; i++) {
+        actuator_slot *slot = &relays->slots[i];
+        if (!(slot->config->safety_groups & group)) continue;
+
+        if (!locked) slot_update(relays, slot, now_us);
+        else if (slot->on) slot_set(relays, slot, false, now_us);
+    }
+    portEXIT_CRITICAL(&relays->lock);
+}
+
+bool actuator_is_on(const actuator *relays, int id) {
+    return id >= 0 && id < relays->count && relays->slots[id].on;
+}
+
+uint32_t actuator_desired_mask(actuator *relays) {
+    uint32_t mask = 0;
+
+    portENTER_CRITICAL(&relays->lock);
+    for (int i = 0; i < relays->count; i++) {
+        if (relays->slots[i].desired) mask |= 1UL << i;
+    }
+    portEXIT_CRITICAL(&relays->lock);
+    return mask;
+}
@@ -0,0 +1,17 @@
+#include "devices.h"
+
+// Освежитель работает не дольше 30 минут за включение; "off" с сервера выключает его сразу
+#define FRESHENER_AUTO_OFF_MS 1800000
+
+const device_config g_devices[] = {
+    {.id = "fan",        .pin = 2,  .safety_groups = DEVICE_GROUP_LIMIT_SWITCH},
+    {.id = "humidifier", .pin = 4,  .safety_groups = DEVICE_GROUP_LIMIT_SWITCH},
+    {.id = "freshener",  .pin = 16, .safety_groups = DEVICE_GROUP_LIMIT_SWITCH,
+     .timing = {.auto_off_ms = FRESHENER_AUTO_OFF_MS}},
+    {.id = "freshener2", .pin = 17, .safety_groups = DEVICE_GROUP_LIMIT_SWITCH,
+     .timing = {.auto_off_ms = FRESHENER_AUTO_OFF_MS}},
+};
+
+const int g_device_count = sizeof(g_devices) / sizeof(g_devices[0]);
+
+_Static_assert(sizeof(g_devices) / sizeof(g_devices[0]) <= DEVICE_MAX, "too many devices, raise DEVICE_MAX");
@@ -0,0 +1,142 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "hal.h"
+#include "metrics.h"
+#include "devices_client.h"
+
+static const char *TAG = "DEVICES_CLIENT";
+
+#define HTTP_TIMEOUT_MS 5000
+#define PUSH_RETRY_MS   300000 // Через сколько снова пробовать long-poll после отката на опрос
+#define BACKOFF_MAX_MS  60000
+
+static void on_http_header(void *ctx, const char *key, const char *value) {
+    devices_client *client = (devices_client *) ctx;
+
+    if (strcasecmp(key, "ETag") == 0) strlcpy(client->pending_etag, value, sizeof(client->pending_etag));
+}
+
+static void on_http_data(void *ctx, const char *data, int len) {
+    devices_client *client = (devices_client *) ctx;
+
+    state_parser_feed(&client->parser, data, len);
+}
+
+static void client_delay(const devices_client *client, uint32_t delay_ms) {
+    if (client->config.jitter_ms) delay_ms += hal_random() % (client->config.jitter_ms + 1);
+    vTaskDelay(pdMS_TO_TICKS(delay_ms));
+}
+
+void devices_client_task(void *pvParameters) {
+    devices_client *client = (devices_client *) pvParameters;
+    const devices_client_config *config = &client->config;
+    hal_http_handlers handlers = {
+        .on_header = on_http_header,
+        .on_data = on_http_data,
+        .ctx = client
+    };
+    // Один клиент на всё время работы - соединение переиспользуется (HTTP keep-alive)
+    hal_http_handle http = hal_http_open(config->url, &handlers);
+    uint32_t requests = 0, not_modified = 0, failed = 0;
+    int64_t started_us = hal_time_us(), push_retry_at_us = 0, stats_at_us = 0;
+    uint32_t backoff_ms = config->poll_period_ms;
+    bool push_supported = config->push, long_poll = false;
+
+    snprintf(client->long_poll_url, sizeof(client->long_poll_url), "%s?wait=%" PRIu32,
+             config->url, config->long_poll_wait_s);
+
+    hal_wifi_wait_connected(UINT32_MAX);
+    // Контроллеры, включённые разом (после отключения питания), не приходят на сервер одновременно
+    client_delay(client, 0);
+
+    while (1) {
+        int64_t now_us = hal_time_us();
+        if (config->push && !push_supported && now_us >= push_retry_at_us) push_supported = true;
+
+        long_poll = push_supported;
+
+        state_parser_reset(&client->parser);
+        client->pending_etag[0] = 0;
+
+        int status = 0;
+        esp_err_t err = hal_http_get(http, long_poll ? client->long_poll_url : config->url,
+                                     client->etag[0] ? client->etag : NULL,
+                                     long_poll ? config->long_poll_wait_s * 1000 + HTTP_TIMEOUT_MS : HTTP_TIMEOUT_MS,
+                                     &status);
+        int64_t elapsed_ms = (hal_time_us() - now_us) / 1000;
+        requests++;
+
+        // Сервер без ETag или не глядящий на If-None-Match отвечает телом сразу, и push крутил бы запросы без паузы
+        bool ignores_etag = status == 200 &&
+                            (!client->pending_etag[0] || strcmp(client->pending_etag, client->etag) == 0);
+        if (long_poll && err == ESP_OK &&
+            ((status == 304 && elapsed_ms < config->long_poll_wait_s * 1000 / 2) || (status >= 400 && status < 500) ||
+             ignores_etag)) {
+            ESP_LOGW(TAG, "Server does not hold long-poll (status %d after %" PRId64 " ms), falling back to polling",
+                     status, elapsed_ms);
+            push_supported = false;
+            push_retry_at_us = hal_time_us() + PUSH_RETRY_MS * 1000LL;
+        }
+
+        esp_err_t parse_err = status == 200 ? state_parser_finish(&client->parser) : ESP_OK;
+        metrics_result result;
+
+        if (err == ESP_OK && status == 304) {
+            not_modified++;
+            result = METRICS_RESULT_NOT_MODIFIED;
+        } else if (err == ESP_OK && status == 200 && parse_err == ESP_OK) {
+            result = METRICS_RESULT_OK;
+            ESP_LOGD(TAG, "Device states (%s): seen 0x%" PRIx32 ", on 0x%" PRIx32, client->pending_etag,
+                     client->parser.seen, client->parser.values);
+
+            const state_parser *parser = &client->parser;
+            uint32_t changed = parser->seen & (~client->server_seen | (parser->values ^ client->server_values));
+            client->server_seen |= parser->seen;
+            client->server_values = (client->server_values & ~parser->seen) | (parser->values & parser->seen);
+            config->on_states(config->ctx, changed, parser->values);
+            strlcpy(client->etag, client->pending_etag, sizeof(client->etag));
+        } else {
+            failed++;
+            result = parse_err != ESP_OK ? METRICS_RESULT_MALFORMED : METRICS_RESULT_ERROR;
+            ESP_LOGE(TAG, "HTTP GET request failed: %s, status %d%s", esp_err_to_name(err), status,
+                     parse_err != ESP_OK ? ", malformed response" : "");
+        }
+        if (config->metrics) {
+            metrics_record_request(long_poll ? METRICS_MODE_PUSH : METRICS_MODE_POLL, result, elapsed_ms);
+        }
+
+        if (config->stats_period_ms && hal_time_us() >= stats_at_us) {
+            stats_at_us = hal_time_us() + config->stats_period_ms * 1000LL;
+            ESP_LOGI(TAG, "Mode: %s, requests: %" PRIu32 " (%" PRId64 "/h), not modified: %" PRIu32
+                     ", failed: %" PRIu32 ", min free heap: %" PRIu32 ", stack high water: %u",
+                     long_poll ? "push" : "poll", requests,
+                     (int64_t) (requests * 3600000000LL / (hal_time_us() - started_us + 1)), not_modified, failed,
+                     hal_min_free_heap(), (unsigned) uxTaskGetStackHighWaterMark(NULL));
+        }
+
+        // Нет Wi-Fi - ждём подключения, а не таймера: запрос уйдёт сразу после него
+        if (err != ESP_OK && !hal_wifi_wait_connected(0)) {
+            hal_wifi_wait_connected(UINT32_MAX);
+            backoff_ms = config->poll_period_ms;
+            continue;
+        }
+
+        // Сервер недоступен или ответил не 200/304 - повторяем с экспоненциальной задержкой.
+        // Иначе в режиме push битый ответ или неожиданный 3xx крутили бы цикл без паузы
+        if (result == METRICS_RESULT_ERROR || result == METRICS_RESULT_MALFORMED) {
+            ESP_LOGW(TAG, "Retrying in %" PRIu32 " ms", backoff_ms);
+            client_delay(client, backoff_ms);
+            backoff_ms = backoff_ms * 2 > BACKOFF_MAX_MS ? BACKOFF_MAX_MS : backoff_ms * 2;
+            continue;
+        }
+        backoff_ms = config->poll_period_ms;
+
+        // В режиме push ожидание уже было на стороне сервера
+        if (!long_poll || !push_supported) client_delay(client, config->poll_period_ms);
+    }
+}
@@ -0,0 +1,352 @@
+#include "sdkconfig.h"
+
+#if !CONFIG_IDF_TARGET_LINUX
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_wifi.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_random.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "esp_http_client.h"
+#include "esp_http_server.h"
+#include "driver/gpio.h"
+#include "hal.h"
+
+static const char *TAG = "HAL";
+
+#define STORAGE_NAMESPACE   "controller"
+#define WIFI_CACHE_KEY      "wifi_ap"
+#define WIFI_BACKOFF_MIN_MS 250
+#define WIFI_BACKOFF_MAX_MS 30000
+
+struct hal_http_client {
+    esp_http_client_handle_t client;
+    hal_http_handlers handlers;
+    const char *url;
+    int timeout_ms;
+};
+
+// Канал и BSSID точки доступа: с ними подключение идёт без полного сканирования
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;
+} wifi_ap_cache;
+
+static EventGroupHandle_t s_wifi_event_group;
+static esp_timer_handle_t s_reconnect_timer;
+static wifi_config_t s_wifi_config;
+static wifi_ap_cache s_ap_cache;
+static bool s_using_cache;
+static uint32_t s_backoff_ms = WIFI_BACKOFF_MIN_MS;
+static int64_t s_disconnected_us; // Когда пропала связь, 0 - подключены
+static uint32_t s_reconnects;
+static httpd_handle_t s_httpd;
+
+/* The event group allows multiple bits for each event, but we only care about one event:
+ * - we are connected to the AP with an IP */
+#define WIFI_CONNECTED_BIT BIT0
+
+void hal_init(void) {
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(err);
+    esp_netif_init();
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+}
+
+esp_err_t hal_storage_get(const char *key, void *data, size_t len) {
+    nvs_handle_t nvs;
+    size_t stored_len = len;
+
+    esp_err_t err = nvs_open(STORAGE_NAMESPACE, NVS_READONLY, &nvs);
+    if (err != ESP_OK) return err;
+    err = nvs_get_blob(nvs, key, data, &stored_len);
+    nvs_close(nvs);
+    if (err == ESP_OK && stored_len != len) err = ESP_ERR_INVALID_SIZE;
+    return err;
+}
+
+esp_err_t hal_storage_set(const char *key, const void *data, size_t len) {
+    nvs_handle_t nvs;
+
+    esp_err_t err = nvs_open(STORAGE_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) return err;
+    err = nvs_set_blob(nvs, key, data, len);
+    if (err == ESP_OK) err = nvs_commit(nvs);
+    nvs_close(nvs);
+    return err;
+}
+
+int64_t IRAM_ATTR hal_time_us(void) {
+    return esp_timer_get_time();
+}
+
+esp_err_t hal_timer_start_periodic(hal_timer_cb cb, void *arg, uint32_t period_ms, const char *name) {
+    esp_timer_handle_t timer;
+    const esp_timer_create_args_t timer_args = {
+        .callback = cb,
+        .arg = arg,
+        .name = name
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &timer);
+    if (err == ESP_OK) err = esp_timer_start_periodic(timer, period_ms * 1000ULL);
+    return err;
+}
+
+uint32_t hal_min_free_heap(void) {
+    return esp_get_minimum_free_heap_size();
+}
+
+uint32_t hal_random(void) {
+    return esp_random();
+}
+
+void hal_output_init(int pin) {
+    esp_rom_gpio_pad_select_gpio(pin);
+    gpio_set_direction(pin, GPIO_MODE_OUTPUT);
+    gpio_set_level(pin, 0);
+}
+
+void hal_output_set(int pin, bool on) {
+    gpio_set_level(pin, on ? 1 : 0);
+}
+
+void hal_input_init(int pin, hal_edge_cb on_edge, void *arg) {
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << pin),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,  
+        .pull_down_en = GPIO_PULLDOWN_DISABLE, 
+        .intr_type = GPIO_INTR_ANYEDGE
+    };
+    gpio_config(&io_conf);
+    gpio_intr_disable(pin); // Включит вызывающий, когда будет готов
+    // Обработчик в IRAM: концевик срабатывает и пока флеш занята записью NVS
+    gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    gpio_isr_handler_add(pin, on_edge, arg);
+}
+
+// gpio_intr_enable/disable в IRAM благодаря CONFIG_GPIO_CTRL_FUNC_IN_IRAM
+void IRAM_ATTR hal_input_edge_enable(int pin, bool enable) {
+    if (enable) gpio_intr_enable(pin);
+    else gpio_intr_disable(pin);
+}
+
+int hal_input_get(int pin) {
+    return gpio_get_level(pin);
+}
+
+static void reconnect_timer_cb(void *arg) {
+    esp_wifi_connect();
+}
+
+// Следующая попытка - к точке из кэша (канал и BSSID) или полным сканированием всех каналов
+static void use_cached_ap(bool cached) {
+    s_using_cache = cached;
+    s_wifi_config.sta.bssid_set = cached;
+    if (cached) memcpy(s_wifi_config.sta.bssid, s_ap_cache.bssid, sizeof(s_ap_cache.bssid));
+    s_wifi_config.sta.channel = cached ? s_ap_cache.channel : 0;
+    s_wifi_config.sta.scan_method = cached ? WIFI_FAST_SCAN : WIFI_ALL_CHANNEL_SCAN;
+    esp_wifi_set_config(WIFI_IF_STA, &s_wifi_config);
+}
+
+static void event_handler(void* arg, esp_event_base_t event_base,
+                          int32_t event_id, void* event_data)
+{
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+        s_disconnected_us = esp_timer_get_time();
+        esp_wifi_connect();
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        wifi_event_sta_connected_t* event = (wifi_event_sta_connected_t*) event_data;
+        wifi_ap_cache ap = {.channel = event->channel};
+        memcpy(ap.bssid, event->bssid, sizeof(ap.bssid));
+
+        // Пишем во флеш, только если точка доступа сменилась
+        if (memcmp(&ap, &s_ap_cache, sizeof(ap)) != 0) {
+            s_ap_cache = ap;
+            hal_storage_set(WIFI_CACHE_KEY, &s_ap_cache, sizeof(s_ap_cache));
+        }
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        if (!s_disconnected_us) {
+            // Связь только что пропала: первая попытка - к той же точке, без сканирования
+            s_disconnected_us = esp_timer_get_time();
+            s_reconnects++;
+            if (s_ap_cache.channel && !s_using_cache) use_cached_ap(true);
+        } else if (s_using_cache) {
+            // Точки из кэша нет (сменили роутер или канал) - до подключения ищем полным сканированием
+            use_cached_ap(false);
+        }
+
+        // Переподключаемся из таймера, чтобы не блокировать цикл событий
+        ESP_LOGI(TAG, "connect to the AP fail, retry in %" PRIu32 " ms", s_backoff_ms);
+        esp_timer_start_once(s_reconnect_timer, s_backoff_ms * 1000ULL);
+        s_backoff_ms = s_backoff_ms * 2 > WIFI_BACKOFF_MAX_MS ? WIFI_BACKOFF_MAX_MS : s_backoff_ms * 2;
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
+        ESP_LOGI(TAG, "got ip:" IPSTR " in %" PRId64 " ms%s", IP2STR(&event->ip_info.ip),
+                 (esp_timer_get_time() - s_disconnected_us) / 1000, s_using_cache ? " (cached AP)" : "");
+        s_disconnected_us = 0;
+        s_backoff_ms = WIFI_BACKOFF_MIN_MS;
+        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+    }
+}
+
+void hal_wifi_start(const char *ssid, const char *password)
+{
+    s_wifi_event_group = xEventGroupCreate();
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = reconnect_timer_cb,
+        .name = "wifi_reconnect"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_reconnect_timer));
+
+    esp_netif_create_default_wifi_sta();
+
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    esp_wifi_init(&cfg);
+
+    esp_event_handler_instance_register(WIFI_EVENT,
+                                        ESP_EVENT_ANY_ID,
+                                        &event_handler,
+                                        NULL,
+                                        NULL);
+    esp_event_handler_instance_register(IP_EVENT,
+                                        IP_EVENT_STA_GOT_IP,
+                                        &event_handler,
+                                        NULL,
+                                        NULL);
+
+    s_wifi_config = (wifi_config_t) {
+        .sta = {
+            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
+            .pmf_cfg = {
+                .capable = true,
+                .required = false
+            },
+        },
+    };
+    strlcpy((char *) s_wifi_config.sta.ssid, ssid, sizeof(s_wifi_config.sta.ssid));
+    strlcpy((char *) s_wifi_config.sta.password, password, sizeof(s_wifi_config.sta.password));
+
+    esp_wifi_set_mode(WIFI_MODE_STA);
+    if (hal_storage_get(WIFI_CACHE_KEY, &s_ap_cache, sizeof(s_ap_cache)) == ESP_OK) {
+        ESP_LOGI(TAG, "Using cached AP on channel %d", s_ap_cache.channel);
+        use_cached_ap(true);
+    } else {
+        esp_wifi_set_config(WIFI_IF_STA, &s_wifi_config);
+    }
+    esp_wifi_start();
+
+    ESP_LOGI(TAG, "wifi_init_sta finished.");
+}
+
+bool hal_wifi_wait_connected(uint32_t timeout_ms) {
+    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT, pdFALSE, pdFALSE,
+                                           timeout_ms == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+    return bits & WIFI_CONNECTED_BIT;
+}
+
+esp_err_t hal_wifi_rssi(int8_t *rssi) {
+    wifi_ap_record_t ap;
+
+    if (!hal_wifi_wait_connected(0) || esp_wifi_sta_get_ap_info(&ap) != ESP_OK) return ESP_ERR_INVALID_STATE;
+    *rssi = ap.rssi;
+    return ESP_OK;
+}
+
+uint32_t hal_wifi_reconnects(void) {
+    return s_reconnects;
+}
+
+static esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
+    struct hal_http_client *http = (struct hal_http_client *) evt->user_data;
+
+    if (evt->event_id == HTTP_EVENT_ON_HEADER && http->handlers.on_header) {
+        http->handlers.on_header(http->handlers.ctx, evt->header_key, evt->header_value);
+    } else if (evt->event_id == HTTP_EVENT_ON_DATA && http->handlers.on_data) {
+        http->handlers.on_data(http->handlers.ctx, (const char *) evt->data, evt->data_len);
+    }
+    return ESP_OK;
+}
+
+hal_http_handle hal_http_open(const char *url, const hal_http_handlers *handlers) {
+    struct hal_http_client *http = calloc(1, sizeof(*http));
+    if (!http) return NULL;
+
+    http->handlers = *handlers;
+    http->url = url;
+    esp_http_client_config_t config = {
+        .url = url,
+        .event_handler = _http_event_handler,
+        .user_data = http
+    };
+    http->client = esp_http_client_init(&config);
+    if (!http->client) {
+        free(http);
+        return NULL;
+    }
+    return http;
+}
+
+esp_err_t hal_http_get(hal_http_handle http, const char *url, const char *if_none_match,
+                       int timeout_ms, int *status) {
+    if (strcmp(url, http->url) != 0) {
+        http->url = url;
+        esp_http_client_set_url(http->client, url);
+    }
+    if (timeout_ms != http->timeout_ms) {
+        http->timeout_ms = timeout_ms;
+        esp_http_client_set_timeout_ms(http->client, timeout_ms);
+    }
+
+    if (if_none_match) esp_http_client_set_header(http->client, "If-None-Match", if_none_match);
+    else esp_http_client_delete_header(http->client, "If-None-Match");
+
+    esp_err_t err = esp_http_client_perform(http->client);
+    *status = esp_http_client_get_status_code(http->client);
+    return err;
+}
+
+static void httpd_write(void *out, const char *text, int len) {
+    httpd_resp_send_chunk((httpd_req_t *) out, text, len);
+}
+
+static esp_err_t httpd_render_handler(httpd_req_t *req) {
+    hal_http_render render = (hal_http_render) req->user_ctx;
+
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    render(httpd_write, req);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+esp_err_t hal_http_serve(const char *uri, hal_http_render render) {
+    if (!s_httpd) {
+        httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+        config.task_priority = 2; // Ниже управляющих задач: опрос метрик не должен им мешать
+        esp_err_t err = httpd_start(&s_httpd, &config);
+        if (err != ESP_OK) return err;
+    }
+
+    const httpd_uri_t handler = {
+        .uri = uri,
+        .method = HTTP_GET,
+        .handler = httpd_render_handler,
+        .user_ctx = render
+    };
+    return httpd_register_uri_handler(s_httpd, &handler);
+}
+
+#endif // !CONFIG_IDF_TARGET_LINUX
@@ -0,0 +1,910 @@
+#include "sdkconfig.h"
+
+#if CONFIG_IDF_TARGET_LINUX
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "devices.h"
+#include "hal.h"
+#include "sim.h"
+
+/* Хостовая сборка. Вместо железа:
+ *  - реле и концевик - массивы уровней в памяти;
+ *  - NVS - несколько записей в памяти, с SIM_NVS_PATH они переживают перезапуск процесса;
+ *  - Wi-Fi - задержка подключения: короткая, если канал и BSSID есть в "NVS", и как у
+ *    полного сканирования, если нет. SIM_WIFI_OUTAGE_MS > 0 - после каждого отчёта связь
+ *    рвётся на столько мс, переподключение идёт с той же паузой 250 мс..30 с, что на плате;
+ *  - перезагрузка - SIM_REBOOTS раз после отчёта процесс запускает себя заново (exec) с
+ *    тем же NVS и тем же состоянием комнаты 0 на "сервере" (SIM_SERVER_STATE - маска
+ *    включённых устройств), так что видно время от старта до первого переключения реле
+ *    с холодным NVS и со снимком реле и точкой доступа в нём;
+ *  - сервер устройств - заглушка в процессе с тем же протоколом (ETag, 304, ?wait=N),
+ *    отдающая тело кусками случайной длины до HAL_SIM_CHUNK байт. У неё
+ *    SIM_SERVER_WORKERS обработчиков (0 - без ограничения) и SIM_SERVER_SERVICE_MS
+ *    на запрос, так что при перегрузке запросы встают в очередь. SIM_SERVER_PUSH=0 -
+ *    сервер не держит long-poll и сразу отвечает 304, как старый сервер без ?wait=N;
+ *  - задача sim_driver раз в SIM_COMMAND_MS меняет состояние случайного устройства
+ *    в случайной комнате "сервера", раз в HAL_SIM_REPORT_MS дёргает концевики и печатает
+ *    замеры реального управляющего цикла прошивки и флота (sim_fleet.c, SIM_FLEET_SIZE).
+ *    SIM_COMMAND_MS=0 - sim_driver не запускается, пинами и сервером управляет тест (sim.h).
+ * SIM_* - переменные окружения, см. sim_env(). */
+
+static const char *TAG = "HAL_SIM";
+
+#define HAL_SIM_PIN_COUNT         64
+#define HAL_SIM_RTT_MS            10
+#define HAL_SIM_CHUNK             16
+#define HAL_SIM_COMMAND_PERIOD_MS 200
+#define HAL_SIM_REPORT_MS         10000
+#define HAL_SIM_SAMPLES           4096
+#define HAL_SIM_SERVICE_MS        1
+#define HAL_SIM_STORAGE_SLOTS     4
+#define HAL_SIM_STORAGE_SIZE      32
+#define HAL_SIM_WIFI_SCAN_MS      1500 // Полное сканирование всех каналов
+#define HAL_SIM_WIFI_CACHED_MS    100  // Подключение к известному каналу и BSSID
+#define HAL_SIM_RSSI_DBM          -55
+#define HAL_SIM_WIFI_CHANNEL      6
+#define HAL_SIM_WIFI_BACKOFF_MIN_MS 250
+#define HAL_SIM_WIFI_BACKOFF_MAX_MS 30000
+#define HAL_SIM_WIFI_KEY          "wifi_ap"
+#define WIFI_CONNECTED_BIT        BIT0
+
+struct hal_http_client {
+    hal_http_handlers handlers;
+    uint64_t exit_cpu_ns;  // Время CPU потока на выходе из прошлого hal_http_get
+    uint64_t exit_allocs;
+    uint64_t handler_cpu_ns; // Обработчики клиента (ETag, разбор тела) внутри текущего hal_http_get
+    uint64_t handler_allocs;
+};
+
+static bool s_outputs[HAL_SIM_PIN_COUNT];
+static int64_t s_output_changed_us[HAL_SIM_PIN_COUNT];
+static int s_inputs[HAL_SIM_PIN_COUNT];
+static hal_edge_cb s_edge_cb[HAL_SIM_PIN_COUNT];
+static void *s_edge_arg[HAL_SIM_PIN_COUNT];
+static bool s_edge_enabled[HAL_SIM_PIN_COUNT];
+
+typedef struct {
+    bool state[DEVICE_MAX];
+    int64_t commanded_us[DEVICE_MAX]; // Когда "сервер" получил команду
+    bool actuated[DEVICE_MAX];        // Реле уже пришло в состояние команды
+    uint32_t version;
+    bool no_etag;                     // Без ETag: If-None-Match и ?wait=N не понимает, всегда тело
+    sim_room_stats stats;
+} sim_room;
+
+static struct {
+    sim_room *rooms;
+    int room_count;
+    SemaphoreHandle_t workers; // Свободные обработчики; NULL - без ограничения
+    uint32_t service_ms;
+    bool push;                 // Держит long-poll (?wait=N)
+    uint32_t requests;
+    uint32_t not_modified;
+    int held;                  // Запросы long-poll, которые сервер держит сейчас
+    int held_peak;
+} s_server;
+
+// Замеры за период отчёта; если их больше HAL_SIM_SAMPLES, хранится равномерная выборка
+typedef struct {
+    int64_t us[HAL_SIM_SAMPLES];
+    uint32_t seen;
+} sim_samples;
+
+static struct {
+    int64_t started_us;
+    sim_samples propagation; // От команды на сервере до реле
+    sim_samples server;      // Ответ сервера без сети и ожидания long-poll
+    uint64_t cycles;
+    uint64_t cycle_cpu_ns;
+    uint64_t cycle_allocs;
+} s_stats;
+
+static struct {
+    char key[16];
+    uint8_t data[HAL_SIM_STORAGE_SIZE];
+    size_t len;
+} s_storage[HAL_SIM_STORAGE_SLOTS];
+
+static const char *s_storage_path;
+
+// Загрузка и подключение после старта процесса
+static struct {
+    int number;            // 0 - первый запуск, дальше - номер перезагрузки
+    int64_t started_us;
+    int64_t actuated_us;   // Первое реле пришло в состояние "сервера", 0 - ещё нет
+    bool from_snapshot;    // ...до подключения к сети, то есть по снимку из NVS
+    int64_t wifi_ms;
+    bool wifi_cached;
+} s_boot;
+
+static struct {
+    TaskHandle_t task;
+    int64_t outage_until_us; // До этого момента точка доступа недоступна
+    uint32_t reconnects;
+    int64_t last_reconnect_ms;
+    bool last_reconnect_cached;
+} s_wifi;
+
+static EventGroupHandle_t s_wifi_event_group;
+static hal_http_render s_metrics_render;
+static int64_t s_clock_offset_us; // sim_clock_advance()
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Счётчик выделений памяти по потокам и занятая куча всего процесса: glibc позволяет
+ * подменить malloc в исполняемом файле, настоящие функции доступны как __libc_*. */
+static __thread uint64_t t_allocs;
+static uint64_t s_heap_allocs;
+static int64_t s_heap_used;
+static int64_t s_heap_peak;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void *__libc_valloc(size_t size);
+extern void *__libc_pvalloc(size_t size);
+
+static void *heap_track(void *ptr, size_t old_size) {
+    int64_t delta = (ptr ? (int64_t) malloc_usable_size(ptr) : 0) - (int64_t) old_size;
+    int64_t used = __atomic_add_fetch(&s_heap_used, delta, __ATOMIC_RELAXED);
+    int64_t peak = __atomic_load_n(&s_heap_peak, __ATOMIC_RELAXED);
+
+    while (used > peak && !__atomic_compare_exchange_n(&s_heap_peak, &peak, used, true,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+    t_allocs++;
+    __atomic_add_fetch(&s_heap_allocs, 1, __ATOMIC_RELAXED);
+    return ptr;
+}
+
+void *malloc(size_t size) {
+    return heap_track(__libc_malloc(size), 0);
+}
+
+void *calloc(size_t n, size_t size) {
+    return heap_track(__libc_calloc(n, size), 0);
+}
+
+void *realloc(void *ptr, size_t size) {
+    size_t old_size = ptr ? malloc_usable_size(ptr) : 0;
+    void *moved = __libc_realloc(ptr, size);
+
+    // При ошибке старый блок остаётся занят
+    return moved || !size ? heap_track(moved, old_size) : NULL;
+}
+
+// Выровненные выделения идут мимо malloc, их тоже нужно считать
+void *memalign(size_t alignment, size_t size) {
+    return heap_track(__libc_memalign(alignment, size), 0);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    return heap_track(__libc_memalign(alignment, size), 0);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+    if (alignment % sizeof(void *) || alignment & (alignment - 1)) return EINVAL;
+
+    void *aligned = __libc_memalign(alignment, size);
+    if (!aligned) return ENOMEM;
+
+    *ptr = heap_track(aligned, 0);
+    return 0;
+}
+
+void *valloc(size_t size) {
+    return heap_track(__libc_valloc(size), 0);
+}
+
+void *pvalloc(size_t size) {
+    return heap_track(__libc_pvalloc(size), 0);
+}
+
+void free(void *ptr) {
+    if (ptr) __atomic_sub_fetch(&s_heap_used, (int64_t) malloc_usable_size(ptr), __ATOMIC_RELAXED);
+    __libc_free(ptr);
+}
+
+void sim_heap_stats(sim_heap *heap) {
+    heap->allocs = __atomic_load_n(&s_heap_allocs, __ATOMIC_RELAXED);
+    heap->used = __atomic_load_n(&s_heap_used, __ATOMIC_RELAXED);
+    heap->peak = __atomic_exchange_n(&s_heap_peak, heap->used, __ATOMIC_RELAXED);
+}
+
+static uint64_t thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int sim_env(const char *name, int fallback) {
+    const char *value = getenv(name);
+    return value && *value ? (int) strtol(value, NULL, 0) : fallback;
+}
+
+// Вызывается под s_lock
+static void samples_add(sim_samples *samples, int64_t us) {
+    static unsigned int seed = 1;
+    uint32_t slot = samples->seen < HAL_SIM_SAMPLES ? samples->seen : rand_r(&seed) % (samples->seen + 1);
+
+    if (slot < HAL_SIM_SAMPLES) samples->us[slot] = us;
+    samples->seen++;
+}
+
+int64_t hal_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000 + __atomic_load_n(&s_clock_offset_us, __ATOMIC_RELAXED);
+}
+
+void sim_clock_advance(int64_t us) {
+    __atomic_add_fetch(&s_clock_offset_us, us, __ATOMIC_RELAXED);
+}
+
+typedef struct {
+    hal_timer_cb cb;
+    void *arg;
+    uint32_t period_ms;
+} sim_timer;
+
+static void sim_timer_task(void *pvParameters) {
+    sim_timer *timer = (sim_timer *) pvParameters;
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(timer->period_ms));
+        timer->cb(timer->arg);
+    }
+}
+
+esp_err_t hal_timer_start_periodic(hal_timer_cb cb, void *arg, uint32_t period_ms, const char *name) {
+    sim_timer *timer = malloc(sizeof(*timer));
+    if (!timer) return ESP_ERR_NO_MEM;
+
+    *timer = (sim_timer) {.cb = cb, .arg = arg, .period_ms = period_ms};
+    return xTaskCreate(&sim_timer_task, name, 4096, timer, 20, NULL) == pdPASS ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+uint32_t hal_min_free_heap(void) {
+    return 0; // На хосте куча не ограничена, смотрите пиковый RSS в отчёте
+}
+
+uint32_t hal_random(void) {
+    static unsigned int seed = 1;
+    uint32_t value;
+
+    portENTER_CRITICAL(&s_lock);
+    value = rand_r(&seed);
+    portEXIT_CRITICAL(&s_lock);
+    return value;
+}
+
+void hal_output_init(int pin) {
+    s_outputs[pin] = false;
+}
+
+void hal_output_set(int pin, bool on) {
+    portENTER_CRITICAL(&s_lock);
+    if (s_outputs[pin] != on) s_output_changed_us[pin] = hal_time_us();
+    s_outputs[pin] = on;
+    portEXIT_CRITICAL(&s_lock);
+
+    for (int i = 0; i < g_device_count; i++) {
+        if (g_devices[i].pin == pin) sim_relay_changed(0, i, on);
+    }
+}
+
+void sim_relay_changed(int room, int device, bool on) {
+    int64_t now_us = hal_time_us();
+    sim_room *r = &s_server.rooms[room];
+
+    portENTER_CRITICAL(&s_lock);
+    if (!r->actuated[device] && r->state[device] == on) {
+        r->actuated[device] = true;
+        // Состояние, которое "сервер" держал ещё до старта, - замер загрузки, а не команды
+        if (room == 0 && r->commanded_us[device] == s_boot.started_us) {
+            if (!s_boot.actuated_us) {
+                s_boot.actuated_us = now_us;
+                s_boot.from_snapshot = !hal_wifi_wait_connected(0);
+            }
+        } else {
+            samples_add(&s_stats.propagation, now_us - r->commanded_us[device]);
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void hal_input_init(int pin, hal_edge_cb on_edge, void *arg) {
+    s_inputs[pin] = 1; // Подтяжка к питанию
+    s_edge_cb[pin] = on_edge;
+    s_edge_arg[pin] = arg;
+    s_edge_enabled[pin] = false;
+}
+
+void hal_input_edge_enable(int pin, bool enable) {
+    s_edge_enabled[pin] = enable;
+}
+
+int hal_input_get(int pin) {
+    return s_inputs[pin];
+}
+
+bool sim_output_get(int pin) {
+    bool on;
+
+    portENTER_CRITICAL(&s_lock);
+    on = s_outputs[pin];
+    portEXIT_CRITICAL(&s_lock);
+    return on;
+}
+
+int64_t sim_output_changed_us(int pin) {
+    int64_t changed_us;
+
+    portENTER_CRITICAL(&s_lock);
+    changed_us = s_output_changed_us[pin];
+    portEXIT_CRITICAL(&s_lock);
+    return changed_us;
+}
+
+void sim_input_set(int pin, int level) {
+    if (s_inputs[pin] == level) return;
+
+    s_inputs[pin] = level;
+    if (s_edge_enabled[pin] && s_edge_cb[pin]) s_edge_cb[pin](s_edge_arg[pin]);
+}
+
+static void storage_load(void) {
+    FILE *file = s_storage_path ? fopen(s_storage_path, "rb") : NULL;
+    if (!file) return;
+
+    if (fread(s_storage, sizeof(s_storage), 1, file) != 1) memset(s_storage, 0, sizeof(s_storage));
+    fclose(file);
+}
+
+static esp_err_t storage_commit(void) {
+    FILE *file = s_storage_path ? fopen(s_storage_path, "wb") : NULL;
+    if (!s_storage_path) return ESP_OK;
+    if (!file) return ESP_FAIL;
+
+    bool written = fwrite(s_storage, sizeof(s_storage), 1, file) == 1;
+    return fclose(file) == 0 && written ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t hal_storage_get(const char *key, void *data, size_t len) {
+    for (int i = 0; i < HAL_SIM_STORAGE_SLOTS; i++) {
+        if (strcmp(s_storage[i].key, key) != 0) continue;
+        if (s_storage[i].len != len) return ESP_ERR_INVALID_SIZE;
+        memcpy(data, s_storage[i].data, len);
+        return ESP_OK;
+    }
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t hal_storage_set(const char *key, const void *data, size_t len) {
+    if (len > HAL_SIM_STORAGE_SIZE || strlen(key) >= sizeof(s_storage[0].key)) return ESP_ERR_INVALID_SIZE;
+
+    for (int i = 0; i < HAL_SIM_STORAGE_SLOTS; i++) {
+        if (s_storage[i].key[0] && strcmp(s_storage[i].key, key) != 0) continue;
+        strcpy(s_storage[i].key, key);
+        memcpy(s_storage[i].data, data, len);
+        s_storage[i].len = len;
+        return storage_commit();
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+// Как обработчик событий в hal_esp32.c: первая попытка после загрузки и после каждого обрыва -
+// к точке доступа из кэша, если она не удалась - полное сканирование. Паузы между попытками от 250 мс до 30 с
+static void sim_wifi_task(void *pvParameters) {
+    uint8_t channel = 0;
+    bool cached = hal_storage_get(HAL_SIM_WIFI_KEY, &channel, sizeof(channel)) == ESP_OK;
+    bool reconnecting = false;
+    uint32_t backoff_ms = HAL_SIM_WIFI_BACKOFF_MIN_MS;
+    int64_t disconnected_us = hal_time_us();
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(cached ? HAL_SIM_WIFI_CACHED_MS : HAL_SIM_WIFI_SCAN_MS));
+
+        if (hal_time_us() < s_wifi.outage_until_us) {
+            cached = false;
+            vTaskDelay(pdMS_TO_TICKS(backoff_ms));
+            backoff_ms = backoff_ms * 2 > HAL_SIM_WIFI_BACKOFF_MAX_MS ? HAL_SIM_WIFI_BACKOFF_MAX_MS : backoff_ms * 2;
+            continue;
+        }
+
+        int64_t connect_ms = (hal_time_us() - disconnected_us) / 1000;
+        if (channel != HAL_SIM_WIFI_CHANNEL) {
+            channel = HAL_SIM_WIFI_CHANNEL;
+            hal_storage_set(HAL_SIM_WIFI_KEY, &channel, sizeof(channel));
+        }
+        ESP_LOGI(TAG, "Simulated Wi-Fi connected in %" PRId64 " ms%s", connect_ms, cached ? " (cached AP)" : "");
+
+        portENTER_CRITICAL(&s_lock);
+        if (reconnecting) {
+            s_wifi.last_reconnect_ms = connect_ms;
+            s_wifi.last_reconnect_cached = cached;
+        } else {
+            s_boot.wifi_ms = connect_ms;
+            s_boot.wifi_cached = cached;
+        }
+        portEXIT_CRITICAL(&s_lock);
+        backoff_ms = HAL_SIM_WIFI_BACKOFF_MIN_MS;
+        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+
+        // Обрыв: sim_wifi_drop()
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        disconnected_us = hal_time_us();
+        reconnecting = true;
+        cached = true; // Канал уже сохранён при подключении
+        portENTER_CRITICAL(&s_lock);
+        s_wifi.reconnects++;
+        portEXIT_CRITICAL(&s_lock);
+
+        ESP_LOGI(TAG, "Simulated Wi-Fi lost, retry in %" PRIu32 " ms", backoff_ms);
+        vTaskDelay(pdMS_TO_TICKS(backoff_ms));
+        backoff_ms = backoff_ms * 2 > HAL_SIM_WIFI_BACKOFF_MAX_MS ? HAL_SIM_WIFI_BACKOFF_MAX_MS : backoff_ms * 2;
+    }
+}
+
+void sim_boot_stats(sim_boot *boot) {
+    portENTER_CRITICAL(&s_lock);
+    boot->number = s_boot.number;
+    boot->actuated_us = s_boot.actuated_us ? s_boot.actuated_us - s_boot.started_us : -1;
+    boot->from_snapshot = s_boot.from_snapshot;
+    boot->wifi_ms = s_boot.wifi_ms;
+    boot->wifi_cached = s_boot.wifi_cached;
+    boot->reconnects = s_wifi.reconnects;
+    boot->last_reconnect_ms = s_wifi.last_reconnect_ms;
+    boot->last_reconnect_cached = s_wifi.last_reconnect_cached;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void sim_wifi_drop(uint32_t outage_ms) {
+    portENTER_CRITICAL(&s_lock);
+    s_wifi.outage_until_us = hal_time_us() + outage_ms * 1000LL;
+    portEXIT_CRITICAL(&s_lock);
+    xTaskNotifyGive(s_wifi.task);
+}
+
+void hal_wifi_start(const char *ssid, const char *password) {
+    xTaskCreate(&sim_wifi_task, "sim_wifi", 4096, NULL, 5, &s_wifi.task);
+}
+
+bool hal_wifi_wait_connected(uint32_t timeout_ms) {
+    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT, pdFALSE, pdFALSE,
+                                           timeout_ms == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+    return bits & WIFI_CONNECTED_BIT;
+}
+
+esp_err_t hal_wifi_rssi(int8_t *rssi) {
+    if (!hal_wifi_wait_connected(0)) return ESP_ERR_INVALID_STATE;
+    *rssi = HAL_SIM_RSSI_DBM;
+    return ESP_OK;
+}
+
+uint32_t hal_wifi_reconnects(void) {
+    uint32_t reconnects;
+
+    portENTER_CRITICAL(&s_lock);
+    reconnects = s_wifi.reconnects;
+    portEXIT_CRITICAL(&s_lock);
+    return reconnects;
+}
+
+hal_http_handle hal_http_open(const char *url, const hal_http_handlers *handlers) {
+    struct hal_http_client *http = calloc(1, sizeof(*http));
+    if (!http) return NULL;
+
+    http->handlers = *handlers;
+    http->exit_cpu_ns = thread_cpu_ns();
+    http->exit_allocs = t_allocs;
+    return http;
+}
+
+static uint32_t server_snapshot(const sim_room *room, bool *state) {
+    uint32_t version;
+
+    portENTER_CRITICAL(&s_lock);
+    memcpy(state, room->state, sizeof(room->state));
+    version = room->version;
+    portEXIT_CRITICAL(&s_lock);
+    return version;
+}
+
+// Очередь к обработчику и сама обработка; ESP_ERR_TIMEOUT, если клиент не дождался
+static esp_err_t server_serve(int timeout_ms) {
+    int64_t arrived_us = hal_time_us();
+
+    if (s_server.workers && xSemaphoreTake(s_server.workers, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    vTaskDelay(pdMS_TO_TICKS(s_server.service_ms));
+    if (s_server.workers) xSemaphoreGive(s_server.workers);
+
+    portENTER_CRITICAL(&s_lock);
+    s_server.requests++;
+    samples_add(&s_stats.server, hal_time_us() - arrived_us);
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+static void server_hold(int delta) {
+    portENTER_CRITICAL(&s_lock);
+    s_server.held += delta;
+    if (s_server.held > s_server.held_peak) s_server.held_peak = s_server.held;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+/* Обработчики клиента работают внутри заглушки сервера, но это управляющий цикл: разбор
+ * тела - его горячий путь. Их время и выделения идут в цикл, а не в работу сервера */
+static void handler_begin(hal_http_handle http) {
+    http->handler_cpu_ns -= thread_cpu_ns();
+    http->handler_allocs -= t_allocs;
+}
+
+static void handler_end(hal_http_handle http) {
+    http->handler_cpu_ns += thread_cpu_ns();
+    http->handler_allocs += t_allocs;
+}
+
+static esp_err_t server_get(hal_http_handle http, const char *url, const char *if_none_match,
+                            int timeout_ms, int *status) {
+    bool state[DEVICE_MAX];
+    char etag[16];
+    char body[DEVICE_MAX * 24];
+    const char *wait = s_server.push ? strstr(url, "wait=") : NULL;
+    const char *room_path = strstr(url, "/rooms/");
+    int room = room_path ? atoi(room_path + strlen("/rooms/")) : 0;
+    bool held = false;
+
+    if (!hal_wifi_wait_connected(0)) return ESP_FAIL;
+
+    vTaskDelay(pdMS_TO_TICKS(HAL_SIM_RTT_MS));
+    esp_err_t err = server_serve(timeout_ms);
+    if (err != ESP_OK) return err;
+
+    if (room < 0 || room >= s_server.room_count) {
+        *status = 404;
+        return ESP_OK;
+    }
+    sim_room_stats *stats = &s_server.rooms[room].stats;
+    bool no_etag = s_server.rooms[room].no_etag;
+    if (no_etag) {
+        if_none_match = NULL;
+        wait = NULL;
+    }
+
+    // Long-poll: держим запрос, пока версия совпадает с If-None-Match. Обработчик
+    // при этом свободен, как у асинхронного сервера
+    int64_t deadline_us = hal_time_us() + (wait ? atoi(wait + 5) * 1000000LL : 0);
+    while (1) {
+        uint32_t version = server_snapshot(&s_server.rooms[room], state);
+        snprintf(etag, sizeof(etag), "\"%" PRIu32 "\"", version);
+        if (!if_none_match || strcmp(if_none_match, etag) != 0) break;
+
+        // Связь оборвалась, пока сервер держал запрос
+        if (!hal_wifi_wait_connected(0)) {
+            if (held) server_hold(-1);
+            return ESP_FAIL;
+        }
+
+        if (hal_time_us() >= deadline_us) {
+            if (held) server_hold(-1);
+            portENTER_CRITICAL(&s_lock);
+            s_server.not_modified++;
+            stats->requests++;
+            stats->not_modified++;
+            portEXIT_CRITICAL(&s_lock);
+            *status = 304;
+            return ESP_OK;
+        }
+        if (!held) server_hold(1);
+        held = true;
+        vTaskDelay(pdMS_TO_TICKS(HAL_SIM_RTT_MS));
+    }
+    if (held) server_hold(-1);
+
+    int len = 0;
+    for (int i = 0; i < g_device_count; i++) {
+        len += snprintf(body + len, sizeof(body) - len, "%s=%d\n", g_devices[i].id, state[i]);
+    }
+
+    // Границы кусков случайные, чтобы разбор ответа проверялся на любом разрезе
+    if (http->handlers.on_header && !no_etag) {
+        handler_begin(http);
+        http->handlers.on_header(http->handlers.ctx, "ETag", etag);
+        handler_end(http);
+    }
+    for (int off = 0, chunk; off < len && http->handlers.on_data; off += chunk) {
+        chunk = 1 + hal_random() % HAL_SIM_CHUNK;
+        if (chunk > len - off) chunk = len - off;
+        handler_begin(http);
+        http->handlers.on_data(http->handlers.ctx, body + off, chunk);
+        handler_end(http);
+    }
+    portENTER_CRITICAL(&s_lock);
+    stats->requests++;
+    stats->bodies++;
+    portEXIT_CRITICAL(&s_lock);
+    *status = 200;
+    return ESP_OK;
+}
+
+void sim_server_room_etag(int room, bool etag) {
+    portENTER_CRITICAL(&s_lock);
+    s_server.rooms[room].no_etag = !etag;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void sim_server_room_stats(int room, sim_room_stats *stats) {
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_server.rooms[room].stats;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t hal_http_get(hal_http_handle http, const char *url, const char *if_none_match,
+                       int timeout_ms, int *status) {
+    // Всё, что поток сделал между запросами, и обработчики ответа внутри запроса - это работа управляющего цикла
+    uint64_t cpu_ns = thread_cpu_ns();
+    uint64_t allocs = t_allocs;
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats.cycles++;
+    s_stats.cycle_cpu_ns += cpu_ns - http->exit_cpu_ns;
+    s_stats.cycle_allocs += allocs - http->exit_allocs;
+    portEXIT_CRITICAL(&s_lock);
+
+    http->handler_cpu_ns = 0;
+    http->handler_allocs = 0;
+    esp_err_t err = server_get(http, url, if_none_match, timeout_ms, status);
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats.cycle_cpu_ns += http->handler_cpu_ns;
+    s_stats.cycle_allocs += http->handler_allocs;
+    portEXIT_CRITICAL(&s_lock);
+    http->exit_cpu_ns = thread_cpu_ns();
+    http->exit_allocs = t_allocs;
+    return err;
+}
+
+// Локального сервера нет: отчёт симуляции печатает ту же страницу в stdout
+esp_err_t hal_http_serve(const char *uri, hal_http_render render) {
+    s_metrics_render = render;
+    return ESP_OK;
+}
+
+esp_err_t sim_http_render(hal_http_write write, void *out) {
+    if (!s_metrics_render) return ESP_ERR_NOT_FOUND;
+    s_metrics_render(write, out);
+    return ESP_OK;
+}
+
+static void sim_write_stdout(void *out, const char *text, int len) {
+    fwrite(text, 1, len, stdout);
+}
+
+void sim_server_command(int room, int id, bool on) {
+    sim_room *r = &s_server.rooms[room];
+
+    portENTER_CRITICAL(&s_lock);
+    r->state[id] = on;
+    r->commanded_us[id] = hal_time_us();
+    r->actuated[id] = false;
+    r->version++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static int compare_int64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *) a, y = *(const int64_t *) b;
+    return (x > y) - (x < y);
+}
+
+// Сортирует выборку и возвращает число замеров в ней
+static int samples_sort(sim_samples *samples) {
+    int count = samples->seen < HAL_SIM_SAMPLES ? samples->seen : HAL_SIM_SAMPLES;
+
+    qsort(samples->us, count, sizeof(samples->us[0]), compare_int64);
+    return count;
+}
+
+static int64_t percentile(const sim_samples *samples, int count, int p) {
+    return count ? samples->us[(count - 1) * p / 100] : 0;
+}
+
+void sim_stats_take(sim_stats *stats) {
+    static sim_samples propagation;
+
+    portENTER_CRITICAL(&s_lock);
+    propagation = s_stats.propagation;
+    stats->cycles = s_stats.cycles;
+    stats->cycle_cpu_ns = s_stats.cycles ? s_stats.cycle_cpu_ns / s_stats.cycles : 0;
+    stats->cycle_allocs = s_stats.cycles ? (double) s_stats.cycle_allocs / s_stats.cycles : 0.0;
+    memset(&s_stats.propagation, 0, sizeof(s_stats.propagation));
+    s_stats.cycles = 0;
+    s_stats.cycle_cpu_ns = 0;
+    s_stats.cycle_allocs = 0;
+    portEXIT_CRITICAL(&s_lock);
+
+    int count = samples_sort(&propagation);
+    stats->commands = propagation.seen;
+    stats->propagation_p50_us = percentile(&propagation, count, 50);
+    stats->propagation_p99_us = percentile(&propagation, count, 99);
+    stats->propagation_max_us = percentile(&propagation, count, 100);
+}
+
+static void sim_report(void) {
+    static sim_samples server;
+    int64_t started_us, now_us = hal_time_us();
+    uint32_t requests, not_modified;
+    int held, held_peak;
+    struct rusage usage;
+    sim_stats stats;
+
+    sim_stats_take(&stats);
+    portENTER_CRITICAL(&s_lock);
+    started_us = s_stats.started_us;
+    server = s_stats.server;
+    requests = s_server.requests;
+    not_modified = s_server.not_modified;
+    held = s_server.held;
+    held_peak = s_server.held_peak;
+    memset(&s_stats.server, 0, sizeof(s_stats.server));
+    s_stats.started_us = now_us;
+    s_server.requests = 0;
+    s_server.not_modified = 0;
+    s_server.held_peak = held;
+    portEXIT_CRITICAL(&s_lock);
+
+    getrusage(RUSAGE_SELF, &usage);
+    int server_count = samples_sort(&server);
+
+    ESP_LOGI(TAG, "commands: %" PRIu32 ", command-to-actuation p50 %" PRId64 " us, p99 %" PRId64 " us, max %" PRId64 " us",
+             stats.commands, stats.propagation_p50_us, stats.propagation_p99_us, stats.propagation_max_us);
+    ESP_LOGI(TAG, "server: %d rooms, %" PRId64 " requests/s (not modified %" PRIu32 "), held long-polls %d (peak %d), "
+             "response p50 %" PRId64 " us, p99 %" PRId64 " us, max %" PRId64 " us",
+             s_server.room_count, (int64_t) requests * 1000000 / (now_us - started_us + 1), not_modified, held, held_peak,
+             percentile(&server, server_count, 50), percentile(&server, server_count, 99),
+             percentile(&server, server_count, 100));
+    portENTER_CRITICAL(&s_lock);
+    int64_t actuated_us = s_boot.actuated_us ? s_boot.actuated_us - s_boot.started_us : -1;
+    int64_t reconnect_ms = s_wifi.last_reconnect_ms;
+    bool reconnect_cached = s_wifi.last_reconnect_cached;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "boot %d: first relay actuated in %" PRId64 " us%s, Wi-Fi connected in %" PRId64 " ms (%s); "
+             "reconnects %" PRIu32 ", last reconnect %" PRId64 " ms (%s)",
+             s_boot.number, actuated_us, s_boot.from_snapshot ? " (relay snapshot)" : "", s_boot.wifi_ms,
+             s_boot.wifi_cached ? "cached AP" : "full scan", hal_wifi_reconnects(), reconnect_ms,
+             reconnect_cached ? "cached AP" : "full scan");
+    ESP_LOGI(TAG, "cycles: %" PRIu64 ", CPU per cycle %" PRIu64 " ns, allocations per cycle %.2f, peak RSS %ld KB",
+             stats.cycles, stats.cycle_cpu_ns, stats.cycle_allocs, usage.ru_maxrss);
+    if (s_metrics_render) s_metrics_render(sim_write_stdout, NULL);
+}
+
+void sim_reboot(void) {
+    static char cmdline[4096];
+    char *argv[64];
+    int argc = 0;
+    char value[16];
+    uint32_t mask = 0;
+    FILE *file = fopen("/proc/self/cmdline", "rb");
+    size_t len = file ? fread(cmdline, 1, sizeof(cmdline) - 1, file) : 0;
+
+    if (file) fclose(file);
+    for (size_t off = 0; off < len && argc < 63; off += strlen(cmdline + off) + 1) argv[argc++] = cmdline + off;
+    argv[argc] = NULL;
+
+    // "Сервер" не перезагружается вместе с контроллером
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < g_device_count; i++) mask |= (uint32_t) s_server.rooms[0].state[i] << i;
+    portEXIT_CRITICAL(&s_lock);
+    snprintf(value, sizeof(value), "0x%" PRIx32, mask);
+    setenv("SIM_SERVER_STATE", value, 1);
+    snprintf(value, sizeof(value), "%d", s_boot.number + 1);
+    setenv("SIM_BOOT", value, 1);
+
+    ESP_LOGW(TAG, "Simulated reboot %d", s_boot.number + 1);
+    fflush(stdout);
+    execv("/proc/self/exe", argv);
+    ESP_LOGE(TAG, "Simulated reboot failed");
+}
+
+static void sim_driver_task(void *pvParameters) {
+    unsigned int seed = 1;
+    uint32_t command_ms = sim_env("SIM_COMMAND_MS", HAL_SIM_COMMAND_PERIOD_MS);
+    uint32_t outage_ms = sim_env("SIM_WIFI_OUTAGE_MS", 0);
+    int reboots = sim_env("SIM_REBOOTS", 0);
+
+    // Команды до подключения ждали бы Wi-Fi и испортили бы замер задержки
+    hal_wifi_wait_connected(UINT32_MAX);
+    int64_t report_at_us = hal_time_us() + HAL_SIM_REPORT_MS * 1000LL;
+    s_stats.started_us = hal_time_us();
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(command_ms));
+
+        // Концевики дёргаем между командами, чтобы они не попали в замер задержки
+        if (hal_time_us() >= report_at_us) {
+            int fleet_room = s_server.room_count > 1 ? 1 + rand_r(&seed) % (s_server.room_count - 1) : 0;
+
+            sim_input_set(LIMIT_SWITCH_PIN, LIMIT_SWITCH_ACTIVE_LEVEL);
+            if (fleet_room) sim_fleet_limit_switch(fleet_room, true);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            sim_input_set(LIMIT_SWITCH_PIN, !LIMIT_SWITCH_ACTIVE_LEVEL);
+            if (fleet_room) sim_fleet_limit_switch(fleet_room, false);
+            vTaskDelay(pdMS_TO_TICKS(100));
+
+            sim_report();
+            if (s_boot.number < reboots) sim_reboot();
+            if (outage_ms) sim_wifi_drop(outage_ms);
+            report_at_us = hal_time_us() + HAL_SIM_REPORT_MS * 1000LL;
+            continue;
+        }
+
+        // Команда в паузу min_on_ms/min_off_ms доходит до реле после неё - так её и видит пользователь
+        int room = rand_r(&seed) % s_server.room_count;
+        int id = rand_r(&seed) % g_device_count;
+        sim_server_command(room, id, !s_server.rooms[room].state[id]);
+    }
+}
+
+void hal_init(void) {
+    static char storage_path[64];
+    int fleet_size = sim_env("SIM_FLEET_SIZE", 0);
+    int workers = sim_env("SIM_SERVER_WORKERS", 0);
+    uint32_t server_state = sim_env("SIM_SERVER_STATE", 0);
+
+    s_boot.number = sim_env("SIM_BOOT", 0);
+    s_boot.started_us = hal_time_us();
+    s_wifi_event_group = xEventGroupCreate();
+
+    // Перезагрузке нужен NVS в файле; без SIM_NVS_PATH берём временный
+    s_storage_path = getenv("SIM_NVS_PATH");
+    if (!s_storage_path && sim_env("SIM_REBOOTS", 0) > 0) {
+        snprintf(storage_path, sizeof(storage_path), "/tmp/sim_nvs_%d.bin", (int) getpid());
+        unlink(storage_path);
+        setenv("SIM_NVS_PATH", storage_path, 1);
+        s_storage_path = storage_path;
+    }
+    storage_load();
+
+    // SIM_SERVER_ROOMS - комнаты 1..N без флота, для своих клиентов теста
+    s_server.room_count = 1 + (fleet_size > 0 ? fleet_size : sim_env("SIM_SERVER_ROOMS", 0));
+    s_server.rooms = calloc(s_server.room_count, sizeof(sim_room));
+    if (!s_server.rooms) abort();
+    s_server.service_ms = sim_env("SIM_SERVER_SERVICE_MS", HAL_SIM_SERVICE_MS);
+    s_server.push = sim_env("SIM_SERVER_PUSH", 1);
+    if (workers > 0) s_server.workers = xSemaphoreCreateCounting(workers, workers);
+
+    // Начальное состояние "сервера" не команда: по включённым в комнате 0 меряем загрузку
+    for (int room = 0; room < s_server.room_count; room++) {
+        for (int i = 0; i < g_device_count; i++) {
+            bool on = room == 0 && (server_state & (1UL << i));
+            s_server.rooms[room].state[i] = on;
+            s_server.rooms[room].commanded_us[i] = s_boot.started_us;
+            s_server.rooms[room].actuated[i] = !on;
+        }
+    }
+    if (sim_env("SIM_COMMAND_MS", HAL_SIM_COMMAND_PERIOD_MS) > 0) {
+        xTaskCreate(&sim_driver_task, "sim_driver", 4096, NULL, 3, NULL);
+    }
+    if (fleet_size > 0) sim_fleet_start(fleet_size);
+}
+
+#endif // CONFIG_IDF_TARGET_LINUX
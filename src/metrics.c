@@ -0,0 +1,199 @@
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "metrics.h"
+#include "devices.h"
+#include "actuator.h"
+#include "hal.h"
+
+#define METRICS_LINE_SIZE 160
+
+// Верхние границы корзин гистограмм длительности запроса, мс. Long-poll держится до 30 с
+static const uint32_t s_duration_bounds_ms[] = {5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 35000};
+#define DURATION_BUCKETS ((int) (sizeof(s_duration_bounds_ms) / sizeof(s_duration_bounds_ms[0])))
+
+static const char *s_mode_names[METRICS_MODE_COUNT] = {"poll", "push"};
+
+// Длительность запроса в push почти целиком - ожидание на сервере, поэтому это отдельная метрика
+static const struct {
+    const char *name;
+    const char *help;
+} s_duration_metrics[METRICS_MODE_COUNT] = {
+    {"controller_http_request_duration_seconds", "Round trip of polling GET /devices"},
+    {"controller_long_poll_hold_seconds", "Time until the server answered GET /devices?wait=N, hold included"},
+};
+static const char *s_result_names[METRICS_RESULT_COUNT] = {"ok", "not_modified", "error", "malformed"};
+
+static uint32_t s_requests[METRICS_MODE_COUNT][METRICS_RESULT_COUNT];
+static uint32_t s_duration_buckets[METRICS_MODE_COUNT][DURATION_BUCKETS + 1]; // Последняя - +Inf
+static uint64_t s_duration_sum_ms[METRICS_MODE_COUNT]; // 32 бит long-poll набрал бы за ~50 дней
+static uint32_t s_toggles[DEVICE_MAX];
+static uint32_t s_limit_trips;
+static const actuator *s_relays;
+
+static inline void counter_add(uint32_t *counter, uint32_t value) {
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static inline uint32_t counter_get(const uint32_t *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+// На ESP32 64-битные атомарные операции - короткая критическая секция из newlib, не блокировка
+static inline void counter64_add(uint64_t *counter, uint64_t value) {
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t counter64_get(const uint64_t *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+void metrics_record_request(metrics_mode mode, metrics_result result, uint32_t duration_ms) {
+    int bucket = 0;
+
+    while (bucket < DURATION_BUCKETS && duration_ms > s_duration_bounds_ms[bucket]) bucket++;
+    counter_add(&s_requests[mode][result], 1);
+    counter_add(&s_duration_buckets[mode][bucket], 1);
+    counter64_add(&s_duration_sum_ms[mode], duration_ms);
+}
+
+void metrics_record_toggle(int device) {
+    if (device >= 0 && device < DEVICE_MAX) counter_add(&s_toggles[device], 1);
+}
+
+void metrics_record_limit_trip(void) {
+    counter_add(&s_limit_trips, 1);
+}
+
+typedef struct {
+    hal_http_write write;
+    void *out;
+    char line[METRICS_LINE_SIZE];
+} metrics_writer;
+
+static void emit(metrics_writer *w, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void emit(metrics_writer *w, const char *format, ...) {
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(w->line, sizeof(w->line), format, args);
+    va_end(args);
+    if (len >= (int) sizeof(w->line)) len = sizeof(w->line) - 1;
+    if (len > 0) w->write(w->out, w->line, len);
+}
+
+static void render_duration(metrics_writer *w, metrics_mode mode) {
+    const char *name = s_duration_metrics[mode].name;
+    uint32_t count = 0;
+
+    emit(w, "# HELP %s %s\n# TYPE %s histogram\n", name, s_duration_metrics[mode].help, name);
+    for (int b = 0; b <= DURATION_BUCKETS; b++) {
+        count += counter_get(&s_duration_buckets[mode][b]);
+        if (b < DURATION_BUCKETS) {
+            emit(w, "%s_bucket{le=\"%" PRIu32 ".%03" PRIu32 "\"} %" PRIu32 "\n",
+                 name, s_duration_bounds_ms[b] / 1000, s_duration_bounds_ms[b] % 1000, count);
+        } else {
+            emit(w, "%s_bucket{le=\"+Inf\"} %" PRIu32 "\n", name, count);
+        }
+    }
+    uint64_t sum_ms = counter64_get(&s_duration_sum_ms[mode]);
+    emit(w, "%s_sum %" PRIu64 ".%03" PRIu64 "\n%s_count %" PRIu32 "\n",
+         name, sum_ms / 1000, sum_ms % 1000, name, count);
+}
+
+static void render_requests(metrics_writer *w) {
+    for (int mode = 0; mode < METRICS_MODE_COUNT; mode++) render_duration(w, mode);
+
+    emit(w, "# HELP controller_http_requests_total Requests to the devices server by outcome\n"
+            "# TYPE controller_http_requests_total counter\n");
+    for (int mode = 0; mode < METRICS_MODE_COUNT; mode++) {
+        for (int result = 0; result < METRICS_RESULT_COUNT; result++) {
+            emit(w, "controller_http_requests_total{mode=\"%s\",result=\"%s\"} %" PRIu32 "\n",
+                 s_mode_names[mode], s_result_names[result], counter_get(&s_requests[mode][result]));
+        }
+    }
+}
+
+static void render_relays(metrics_writer *w) {
+    emit(w, "# HELP controller_relay_toggles_total Relay state changes\n"
+            "# TYPE controller_relay_toggles_total counter\n");
+    for (int i = 0; i < g_device_count; i++) {
+        emit(w, "controller_relay_toggles_total{device=\"%s\"} %" PRIu32 "\n", g_devices[i].id, counter_get(&s_toggles[i]));
+    }
+
+    emit(w, "# HELP controller_relay_on Current relay state\n"
+            "# TYPE controller_relay_on gauge\n");
+    for (int i = 0; i < g_device_count; i++) {
+        emit(w, "controller_relay_on{device=\"%s\"} %d\n", g_devices[i].id, actuator_is_on(s_relays, i));
+    }
+
+    emit(w, "# HELP controller_limit_switch_trips_total Limit switch trips\n"
+            "# TYPE controller_limit_switch_trips_total counter\n"
+            "controller_limit_switch_trips_total %" PRIu32 "\n", counter_get(&s_limit_trips));
+}
+
+static void render_system(metrics_writer *w) {
+    int8_t rssi;
+
+    if (hal_wifi_rssi(&rssi) == ESP_OK) {
+        emit(w, "# HELP controller_wifi_rssi_dbm Signal of the current access point\n"
+                "# TYPE controller_wifi_rssi_dbm gauge\n"
+                "controller_wifi_rssi_dbm %d\n", rssi);
+    }
+    emit(w, "# HELP controller_wifi_reconnects_total Times the access point was lost\n"
+            "# TYPE controller_wifi_reconnects_total counter\n"
+            "controller_wifi_reconnects_total %" PRIu32 "\n", hal_wifi_reconnects());
+    emit(w, "# HELP controller_heap_min_free_bytes Lowest free heap since boot\n"
+            "# TYPE controller_heap_min_free_bytes gauge\n"
+            "controller_heap_min_free_bytes %" PRIu32 "\n", hal_min_free_heap());
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    UBaseType_t count = uxTaskGetNumberOfTasks();
+    TaskStatus_t *tasks = malloc(count * sizeof(TaskStatus_t));
+    if (!tasks) return;
+
+    count = uxTaskGetSystemState(tasks, count, NULL);
+
+    emit(w, "# HELP controller_task_stack_free_bytes Stack high-water mark per task\n"
+            "# TYPE controller_task_stack_free_bytes gauge\n");
+    for (UBaseType_t i = 0; i < count; i++) {
+        emit(w, "controller_task_stack_free_bytes{task=\"%s\"} %" PRIu32 "\n",
+             tasks[i].pcTaskName, (uint32_t) tasks[i].usStackHighWaterMark);
+    }
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    /* Счётчик времени задачи в мкс (RUN_TIME_STATS_USING_ESP_TIMER), 64 бита: 32-битный
+     * переполнялся бы через 71 минуту. Текущую загрузку считает Prometheus через rate() */
+    emit(w, "# HELP controller_task_cpu_seconds_total CPU time per task since boot\n"
+            "# TYPE controller_task_cpu_seconds_total counter\n");
+    for (UBaseType_t i = 0; i < count; i++) {
+        uint64_t cpu_us = tasks[i].ulRunTimeCounter;
+        emit(w, "controller_task_cpu_seconds_total{task=\"%s\"} %" PRIu64 ".%06" PRIu64 "\n",
+             tasks[i].pcTaskName, cpu_us / 1000000, cpu_us % 1000000);
+    }
+#endif
+    free(tasks);
+#endif
+}
+
+static void render_metrics(hal_http_write write, void *out) {
+    metrics_writer *w = malloc(sizeof(*w));
+    if (!w) return;
+
+    w->write = write;
+    w->out = out;
+    render_requests(w);
+    render_relays(w);
+    render_system(w);
+    free(w);
+}
+
+esp_err_t metrics_start(const actuator *relays) {
+    s_relays = relays;
+    return hal_http_serve("/metrics", render_metrics);
+}
@@ -0,0 +1,115 @@
+#include "sdkconfig.h"
+
+#if CONFIG_IDF_TARGET_LINUX
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "devices.h"
+#include "devices_client.h"
+#include "actuator.h"
+#include "hal.h"
+#include "sim.h"
+
+/* Флот виртуальных контроллеров - нагрузка на сервер устройств, как от сотен комнат.
+ *
+ * Каждый контроллер - отдельная задача с клиентом протокола прошивки (devices_client.c
+ * и state_parser.c без изменений), который ходит в свою комнату заглушки сервера из
+ * hal_linux.c, и свой планировщик реле (actuator.c) с ограничениями по времени из
+ * таблицы устройств. Вместо GPIO реле сообщают о переключении симулятору, концевик
+ * блокирует группу так же, как на плате. Тики всех планировщиков делает один таймер.
+ *
+ * Запуск хостовой сборки (idf.py --preview set-target linux && idf.py build):
+ *   SIM_FLEET_SIZE=1000 SIM_SERVER_WORKERS=8 ./build/Weather-simulation-system.elf
+ * Настройки флота:
+ *   SIM_FLEET_SIZE      - число виртуальных контроллеров, 0 - только прошивка
+ *   SIM_FLEET_PUSH      - 1: long-poll с откатом на опрос, 0: только опрос
+ *   SIM_FLEET_POLL_MS   - период опроса
+ *   SIM_FLEET_JITTER_MS - случайная добавка к паузам и к старту каждого контроллера
+ * Настройки сервера и команд - в hal_linux.c. Частоту запросов, время ответа
+ * сервера и задержку от команды до реле по всему флоту печатает отчёт sim_driver. */
+
+static const char *TAG = "SIM_FLEET";
+
+#define SIM_FLEET_POLL_MS   1000
+#define SIM_FLEET_JITTER_MS 500
+#define SIM_FLEET_WAIT_S    30
+#define SIM_FLEET_STACK     4096
+
+typedef struct {
+    devices_client client;
+    actuator relays;
+    int room;
+    char url[DEVICES_CLIENT_URL_SIZE / 2]; // Вторая половина - на ?wait=N в long_poll_url
+} sim_controller;
+
+static sim_controller *s_controllers; // Комната n - s_controllers[n - 1]
+static int s_count;
+
+static void relay_output(void *ctx, int id, bool on) {
+    sim_controller *controller = (sim_controller *) ctx;
+
+    sim_relay_changed(controller->room, id, on);
+}
+
+static void on_device_states(void *ctx, uint32_t changed, uint32_t values) {
+    sim_controller *controller = (sim_controller *) ctx;
+
+    for (int i = 0; i < g_device_count; i++) {
+        if (changed & (1UL << i)) actuator_request(&controller->relays, i, values & (1UL << i));
+    }
+}
+
+static void fleet_tick(void *arg) {
+    for (int i = 0; i < s_count; i++) actuator_tick(&s_controllers[i].relays);
+}
+
+void sim_fleet_limit_switch(int room, bool tripped) {
+    if (room < 1 || room > s_count) return;
+
+    actuator_lockout(&s_controllers[room - 1].relays, DEVICE_GROUP_LIMIT_SWITCH, tripped);
+}
+
+void sim_fleet_start(int count) {
+    devices_client_config config = {
+        .push = sim_env("SIM_FLEET_PUSH", 1),
+        .long_poll_wait_s = SIM_FLEET_WAIT_S,
+        .poll_period_ms = sim_env("SIM_FLEET_POLL_MS", SIM_FLEET_POLL_MS),
+        .jitter_ms = sim_env("SIM_FLEET_JITTER_MS", SIM_FLEET_JITTER_MS),
+        .on_states = on_device_states
+    };
+
+    s_controllers = calloc(count, sizeof(*s_controllers));
+    if (!s_controllers) {
+        ESP_LOGE(TAG, "No memory for %d virtual controllers", count);
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        sim_controller *controller = &s_controllers[i];
+        char name[16];
+
+        controller->room = i + 1;
+        snprintf(controller->url, sizeof(controller->url), SIM_SERVER_URL "/rooms/%d/devices", controller->room);
+        controller->client.config = config;
+        controller->client.config.url = controller->url;
+        controller->client.config.ctx = controller;
+        actuator_init(&controller->relays, g_devices, g_device_count, relay_output, controller);
+
+        snprintf(name, sizeof(name), "fleet_%d", controller->room);
+        if (xTaskCreate(&devices_client_task, name, SIM_FLEET_STACK, &controller->client, 5, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Could not start virtual controller %d", controller->room);
+            break;
+        }
+        s_count++;
+    }
+    hal_timer_start_periodic(fleet_tick, NULL, ACTUATOR_TICK_MS, "fleet_tick");
+
+    ESP_LOGI(TAG, "%d virtual controllers, %s, poll period %" PRIu32 " ms, jitter %" PRIu32 " ms", s_count,
+             config.push ? "long-poll" : "polling only", config.poll_period_ms, config.jitter_ms);
+}
+
+#endif // CONFIG_IDF_TARGET_LINUX
@@ -0,0 +1,87 @@
+#include <stdbool.h>
+#include "state_parser.h"
+
+#define DEVICE_ID_MAX 32 // Длиннее имя быть не может - дальше ответ считается испорченным
+
+enum {
+    PARSER_LINE_START, // Начало строки, допустимы пустые строки
+    PARSER_NAME,
+    PARSER_VALUE,      // После '='
+    PARSER_LINE_END,   // После значения, ждём конец строки
+    PARSER_ERROR
+};
+
+static uint32_t all_devices(void) {
+    return g_device_count == 32 ? UINT32_MAX : (1UL << g_device_count) - 1;
+}
+
+static bool is_name_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+}
+
+void state_parser_reset(state_parser *parser) {
+    parser->state = PARSER_LINE_START;
+    parser->name_len = 0;
+    parser->candidates = 0;
+    parser->seen = 0;
+    parser->values = 0;
+}
+
+// Оставляет среди кандидатов только устройства, у которых в позиции pos стоит c
+static uint32_t filter_candidates(uint32_t candidates, int pos, char c) {
+    for (uint32_t rest = candidates; rest; rest &= rest - 1) {
+        int i = __builtin_ctz(rest);
+        if (g_devices[i].id[pos] != c) candidates &= ~(1UL << i);
+    }
+    return candidates;
+}
+
+esp_err_t state_parser_feed(state_parser *parser, const char *data, int len) {
+    for (int n = 0; n < len && parser->state != PARSER_ERROR; n++) {
+        char c = data[n];
+
+        switch (parser->state) {
+        case PARSER_LINE_START:
+            if (c == '\r' || c == '\n') break;
+            parser->state = PARSER_NAME;
+            parser->name_len = 0;
+            parser->candidates = all_devices();
+            // fallthrough
+        case PARSER_NAME:
+            if (c == '=' && parser->name_len > 0) {
+                // Совпадение - кандидат, чьё имя кончилось ровно здесь
+                parser->candidates = filter_candidates(parser->candidates, parser->name_len, 0);
+                parser->state = PARSER_VALUE;
+            } else if (is_name_char(c) && parser->name_len < DEVICE_ID_MAX) {
+                parser->candidates = filter_candidates(parser->candidates, parser->name_len, c);
+                parser->name_len++;
+            } else {
+                parser->state = PARSER_ERROR;
+            }
+            break;
+        case PARSER_VALUE:
+            if (c != '0' && c != '1') {
+                parser->state = PARSER_ERROR;
+                break;
+            }
+            // Если устройство встретилось дважды, побеждает последняя строка
+            parser->seen |= parser->candidates;
+            if (c == '1') parser->values |= parser->candidates;
+            else parser->values &= ~parser->candidates;
+            parser->state = PARSER_LINE_END;
+            break;
+        case PARSER_LINE_END:
+            if (c == '\n') parser->state = PARSER_LINE_START;
+            else if (c != '\r') parser->state = PARSER_ERROR;
+            break;
+        }
+    }
+    return parser->state == PARSER_ERROR ? ESP_ERR_INVALID_RESPONSE : ESP_OK;
+}
+
+esp_err_t state_parser_finish(state_parser *parser) {
+    // Последняя строка может быть без перевода строки, но не без значения
+    if (parser->state == PARSER_LINE_START || parser->state == PARSER_LINE_END) return ESP_OK;
+    parser->state = PARSER_ERROR;
+    return ESP_ERR_INVALID_RESPONSE;
+}
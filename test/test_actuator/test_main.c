@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include "unity.h"
+#include "actuator.h"
+#include "devices.h"
+#include "hal.h"
+#include "sim.h"
+
+/* Планировщик реле на симулированных часах: тест сам вызывает actuator_tick() раз
+ * в ACTUATOR_TICK_MS и сдвигает hal_time_us() через sim_clock_advance(), так что
+ * минуты пауз проходят мгновенно. Таймер actuator_start() не нужен. */
+
+#define MIN_ON_MS   5000
+#define MIN_OFF_MS  3000
+#define AUTO_OFF_MS 60000
+#define DWELL       0
+#define FRESHENER   1
+#define TICK_US     (ACTUATOR_TICK_MS * 1000LL)
+
+static const device_config s_devices[] = {
+    {.id = "dwell",     .pin = 2, .timing = {.min_on_ms = MIN_ON_MS, .min_off_ms = MIN_OFF_MS}},
+    {.id = "freshener", .pin = 4, .timing = {.auto_off_ms = AUTO_OFF_MS}},
+};
+
+static actuator s_relays;
+static int s_switches[2];
+static int64_t s_switched_us[2];
+
+static void relay_output(void *ctx, int id, bool on) {
+    s_switches[id]++;
+    s_switched_us[id] = hal_time_us();
+}
+
+void setUp(void) {
+    TEST_ASSERT_EQUAL(ESP_OK, actuator_init(&s_relays, s_devices, 2, relay_output, NULL));
+    s_switches[DWELL] = s_switches[FRESHENER] = 0;
+}
+
+void tearDown(void) {}
+
+// Тики планировщика в течение ms симулированного времени
+static void run_ticks(int ms) {
+    for (int i = 0; i < ms / ACTUATOR_TICK_MS; i++) {
+        sim_clock_advance(TICK_US);
+        actuator_tick(&s_relays);
+    }
+}
+
+static void test_command_outside_dwell_applies_at_once(void) {
+    actuator_request(&s_relays, DWELL, true);
+    TEST_ASSERT_TRUE(actuator_is_on(&s_relays, DWELL));
+    TEST_ASSERT_EQUAL(1, s_switches[DWELL]);
+}
+
+static void test_off_during_min_on_applies_within_one_tick_after_it(void) {
+    actuator_request(&s_relays, DWELL, true);
+    int64_t dwell_end_us = s_switched_us[DWELL] + MIN_ON_MS * 1000LL;
+
+    run_ticks(1000);
+    actuator_request(&s_relays, DWELL, false);
+    TEST_ASSERT_TRUE_MESSAGE(actuator_is_on(&s_relays, DWELL), "relay turned off during min_on");
+
+    run_ticks(MIN_ON_MS - 1000 - ACTUATOR_TICK_MS);
+    TEST_ASSERT_TRUE(actuator_is_on(&s_relays, DWELL));
+    run_ticks(2 * ACTUATOR_TICK_MS);
+    TEST_ASSERT_FALSE(actuator_is_on(&s_relays, DWELL));
+    TEST_ASSERT_GREATER_OR_EQUAL_INT64(dwell_end_us, s_switched_us[DWELL]);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(dwell_end_us + TICK_US, s_switched_us[DWELL]);
+}
+
+static void test_on_during_min_off_applies_within_one_tick_after_it(void) {
+    actuator_request(&s_relays, DWELL, true);
+    run_ticks(MIN_ON_MS);
+    actuator_request(&s_relays, DWELL, false);
+    TEST_ASSERT_FALSE(actuator_is_on(&s_relays, DWELL));
+    int64_t dwell_end_us = s_switched_us[DWELL] + MIN_OFF_MS * 1000LL;
+
+    run_ticks(ACTUATOR_TICK_MS);
+    actuator_request(&s_relays, DWELL, true);
+    TEST_ASSERT_FALSE_MESSAGE(actuator_is_on(&s_relays, DWELL), "relay turned on during min_off");
+
+    run_ticks(MIN_OFF_MS);
+    TEST_ASSERT_TRUE(actuator_is_on(&s_relays, DWELL));
+    TEST_ASSERT_GREATER_OR_EQUAL_INT64(dwell_end_us, s_switched_us[DWELL]);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(dwell_end_us + TICK_US, s_switched_us[DWELL]);
+}
+
+static void test_command_reverted_during_dwell_never_switches(void) {
+    actuator_request(&s_relays, DWELL, true);
+    actuator_request(&s_relays, DWELL, false);
+    run_ticks(1000);
+    actuator_request(&s_relays, DWELL, true);
+    run_ticks(MIN_ON_MS);
+    TEST_ASSERT_TRUE(actuator_is_on(&s_relays, DWELL));
+    TEST_ASSERT_EQUAL(1, s_switches[DWELL]);
+}
+
+static void test_auto_off_within_one_tick(void) {
+    actuator_request(&s_relays, FRESHENER, true);
+    int64_t auto_off_us = s_switched_us[FRESHENER] + AUTO_OFF_MS * 1000LL;
+
+    run_ticks(AUTO_OFF_MS + ACTUATOR_TICK_MS);
+    TEST_ASSERT_FALSE(actuator_is_on(&s_relays, FRESHENER));
+    TEST_ASSERT_GREATER_OR_EQUAL_INT64(auto_off_us, s_switched_us[FRESHENER]);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(auto_off_us + TICK_US, s_switched_us[FRESHENER]);
+
+    // Автоотключение сбрасывает запрос: следующий тик не включает освежитель обратно
+    run_ticks(ACTUATOR_TICK_MS * 10);
+    TEST_ASSERT_FALSE(actuator_is_on(&s_relays, FRESHENER));
+    TEST_ASSERT_EQUAL(2, s_switches[FRESHENER]);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_command_outside_dwell_applies_at_once);
+    RUN_TEST(test_off_during_min_on_applies_within_one_tick_after_it);
+    RUN_TEST(test_on_during_min_off_applies_within_one_tick_after_it);
+    RUN_TEST(test_command_reverted_during_dwell_never_switches);
+    RUN_TEST(test_auto_off_within_one_tick);
+    return UNITY_END();
+}
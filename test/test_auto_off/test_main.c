@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "actuator.h"
+#include "devices.h"
+#include "controller_config.h"
+#include "hal.h"
+#include "sim.h"
+
+/* Автоотключение освежителя в хостовой сборке прошивки. "Сервер" держит освежитель
+ * включённым (SIM_SERVER_STATE), часы сдвигаются на его 30 минут (sim_clock_advance).
+ * Ответы сервера с тем же значением - из-за команды другому устройству или после
+ * перезагрузки (sim_reboot, второй запуск того же теста) - не должны включать его снова. */
+
+#define FAN              0
+#define FRESHENER        2
+#define SERVER_STATE     (1 << FRESHENER)
+#define WAIT_MS          5000
+#define SETTLE_MS        300
+#define SNAPSHOT_WAIT_MS (2 * RELAY_SNAPSHOT_PERIOD_MS + 500) // Два периода проверки снимка и запас
+
+void app_main(void);
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static bool wait_relay(int id, bool on) {
+    for (int waited = 0; waited < WAIT_MS; waited++) {
+        if (sim_output_get(g_devices[id].pin) == on) return true;
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    return false;
+}
+
+static void command_and_settle(int id, bool on) {
+    sim_server_command(0, id, on);
+    TEST_ASSERT_TRUE(wait_relay(id, on));
+    vTaskDelay(pdMS_TO_TICKS(SETTLE_MS));
+}
+
+static void test_freshener_turns_off_by_itself(void) {
+    TEST_ASSERT_TRUE_MESSAGE(wait_relay(FRESHENER, true), "freshener did not follow the server");
+
+    sim_clock_advance((g_devices[FRESHENER].timing.auto_off_ms + ACTUATOR_TICK_MS) * 1000LL);
+    TEST_ASSERT_TRUE_MESSAGE(wait_relay(FRESHENER, false), "freshener did not auto-off");
+}
+
+static void test_repeated_body_keeps_freshener_off(void) {
+    // Каждая команда вентилятору - новый ответ с телом, где освежитель всё ещё 1
+    command_and_settle(FAN, true);
+    TEST_ASSERT_FALSE_MESSAGE(sim_output_get(g_devices[FRESHENER].pin), "a fan command turned the freshener back on");
+    command_and_settle(FAN, false);
+    TEST_ASSERT_FALSE_MESSAGE(sim_output_get(g_devices[FRESHENER].pin), "a fan command turned the freshener back on");
+}
+
+static void test_server_off_then_on_runs_freshener_again(void) {
+    command_and_settle(FRESHENER, false);
+    command_and_settle(FRESHENER, true);
+    TEST_ASSERT_TRUE(sim_output_get(g_devices[FRESHENER].pin));
+
+    sim_clock_advance((g_devices[FRESHENER].timing.auto_off_ms + ACTUATOR_TICK_MS) * 1000LL);
+    TEST_ASSERT_TRUE(wait_relay(FRESHENER, false));
+    // Снимок в NVS пишется и после автоотключения, без ответа сервера
+    vTaskDelay(pdMS_TO_TICKS(SNAPSHOT_WAIT_MS));
+}
+
+static void test_reboot_keeps_freshener_off(void) {
+    sim_room_stats stats;
+
+    // Первый ответ после загрузки: освежитель на сервере всё ещё 1
+    for (int waited = 0; waited < WAIT_MS; waited++) {
+        sim_server_room_stats(0, &stats);
+        if (stats.bodies > 0) break;
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, stats.bodies);
+    vTaskDelay(pdMS_TO_TICKS(SETTLE_MS));
+    TEST_ASSERT_FALSE_MESSAGE(sim_output_get(g_devices[FRESHENER].pin), "reboot turned the freshener back on");
+}
+
+int main(void) {
+    char nvs_path[64];
+    int boot = sim_env("SIM_BOOT", 0);
+
+    if (boot == 0) {
+        char server_state[16];
+
+        snprintf(nvs_path, sizeof(nvs_path), "/tmp/test_auto_off_%d.bin", (int) getpid());
+        unlink(nvs_path);
+        setenv("SIM_NVS_PATH", nvs_path, 1);
+        snprintf(server_state, sizeof(server_state), "0x%x", SERVER_STATE);
+        setenv("SIM_SERVER_STATE", server_state, 1);
+        setenv("SIM_COMMAND_MS", "0", 1);
+    }
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    app_main();
+
+    UNITY_BEGIN();
+    if (boot == 0) {
+        RUN_TEST(test_freshener_turns_off_by_itself);
+        RUN_TEST(test_repeated_body_keeps_freshener_off);
+        RUN_TEST(test_server_off_then_on_runs_freshener_again);
+        // Второй запуск продолжает вывод тех же тестов после перезагрузки
+        if (Unity.TestFailures == 0) sim_reboot();
+        return UNITY_END();
+    }
+    RUN_TEST(test_reboot_keeps_freshener_off);
+    unlink(getenv("SIM_NVS_PATH"));
+    return UNITY_END();
+}
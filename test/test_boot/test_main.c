@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "devices.h"
+#include "controller_config.h"
+#include "hal.h"
+#include "sim.h"
+
+/* Загрузка и переподключение Wi-Fi в хостовой сборке прошивки. Первый запуск - с пустым
+ * NVS (SIM_NVS_PATH): реле ждут сервера, Wi-Fi ищет точку полным сканированием. Затем
+ * обрывы связи и перезагрузка (sim_reboot): второй запуск того же теста включает реле
+ * по снимку из NVS до подключения и подключается к точке из кэша. */
+
+#define SERVER_STATE         0x3   // Устройства 0 и 1 включены
+#define WAIT_MS              10000
+#define COLD_ACTUATION_MAX_US 3000000 // Полное сканирование (1,5 с в симуляторе) и первый ответ сервера
+#define SNAPSHOT_ACTUATION_MAX_US 50000
+#define CACHED_CONNECT_MAX_MS 500
+#define SHORT_DROP_RECONNECT_MAX_MS 1000 // Пауза 250 мс и подключение к точке из кэша
+#define OUTAGE_MS            2000
+#define OUTAGE_RECONNECT_MAX_MS 6000
+#define SNAPSHOT_WAIT_MS     (2 * RELAY_SNAPSHOT_PERIOD_MS + 500) // Два периода проверки снимка и запас
+
+void app_main(void);
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static sim_boot wait_actuated(void) {
+    sim_boot boot;
+
+    for (int waited = 0; waited < WAIT_MS; waited++) {
+        sim_boot_stats(&boot);
+        if (boot.actuated_us >= 0 && boot.wifi_ms > 0) break;
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    return boot;
+}
+
+// Обрыв связи и переподключение после него
+static sim_boot drop_and_reconnect(uint32_t outage_ms) {
+    sim_boot boot;
+
+    sim_boot_stats(&boot);
+    uint32_t reconnects = boot.reconnects;
+    sim_wifi_drop(outage_ms);
+    for (int waited = 0; waited < WAIT_MS && boot.reconnects == reconnects; waited++) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+        sim_boot_stats(&boot);
+    }
+    TEST_ASSERT_EQUAL_UINT32(reconnects + 1, boot.reconnects);
+    TEST_ASSERT_TRUE_MESSAGE(hal_wifi_wait_connected(WAIT_MS), "Wi-Fi did not reconnect");
+    sim_boot_stats(&boot);
+    return boot;
+}
+
+static void report(const char *what, int64_t value, const char *unit, bool cached) {
+    char message[96];
+
+    snprintf(message, sizeof(message), "%s in %lld %s (%s)", what, (long long) value, unit,
+             cached ? "cached AP" : "full scan");
+    TEST_MESSAGE(message);
+}
+
+static void test_cold_boot_waits_for_the_server(void) {
+    sim_boot boot = wait_actuated();
+
+    report("cold boot: first relay actuated", boot.actuated_us, "us", boot.wifi_cached);
+    TEST_ASSERT_GREATER_OR_EQUAL_INT64(0, boot.actuated_us);
+    TEST_ASSERT_FALSE(boot.from_snapshot);
+    TEST_ASSERT_FALSE(boot.wifi_cached);
+    TEST_ASSERT_GREATER_OR_EQUAL_INT64(boot.wifi_ms * 1000, boot.actuated_us);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(COLD_ACTUATION_MAX_US, boot.actuated_us);
+}
+
+static void test_drop_reconnects_through_cached_ap(void) {
+    sim_boot boot = drop_and_reconnect(0);
+
+    report("short drop: reconnected", boot.last_reconnect_ms, "ms", boot.last_reconnect_cached);
+    TEST_ASSERT_TRUE_MESSAGE(boot.last_reconnect_cached, "reconnect after a drop did a full scan");
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(SHORT_DROP_RECONNECT_MAX_MS, boot.last_reconnect_ms);
+
+    // Каждый обрыв, а не только первый
+    boot = drop_and_reconnect(0);
+    TEST_ASSERT_TRUE_MESSAGE(boot.last_reconnect_cached, "second reconnect did a full scan");
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(SHORT_DROP_RECONNECT_MAX_MS, boot.last_reconnect_ms);
+}
+
+static void test_outage_falls_back_to_full_scan(void) {
+    sim_boot boot = drop_and_reconnect(OUTAGE_MS);
+
+    report("2 s outage: reconnected", boot.last_reconnect_ms, "ms", boot.last_reconnect_cached);
+    TEST_ASSERT_FALSE(boot.last_reconnect_cached);
+    TEST_ASSERT_GREATER_OR_EQUAL_INT64(OUTAGE_MS, boot.last_reconnect_ms);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(OUTAGE_RECONNECT_MAX_MS, boot.last_reconnect_ms);
+
+    // После полного сканирования следующий обрыв снова начинается с точки из кэша
+    boot = drop_and_reconnect(0);
+    TEST_ASSERT_TRUE(boot.last_reconnect_cached);
+}
+
+static void test_snapshot_boot_actuates_before_wifi(void) {
+    sim_boot boot = wait_actuated();
+
+    report("boot from snapshot: first relay actuated", boot.actuated_us, "us", boot.wifi_cached);
+    report("boot from snapshot: Wi-Fi connected", boot.wifi_ms, "ms", boot.wifi_cached);
+    TEST_ASSERT_EQUAL(1, boot.number);
+    TEST_ASSERT_TRUE(boot.from_snapshot);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(SNAPSHOT_ACTUATION_MAX_US, boot.actuated_us);
+    TEST_ASSERT_TRUE(boot.wifi_cached);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(CACHED_CONNECT_MAX_MS, boot.wifi_ms);
+}
+
+int main(void) {
+    char nvs_path[64];
+    int boot = sim_env("SIM_BOOT", 0);
+
+    if (boot == 0) {
+        char server_state[16];
+
+        snprintf(nvs_path, sizeof(nvs_path), "/tmp/test_boot_%d.bin", (int) getpid());
+        unlink(nvs_path);
+        setenv("SIM_NVS_PATH", nvs_path, 1);
+        snprintf(server_state, sizeof(server_state), "0x%x", SERVER_STATE);
+        setenv("SIM_SERVER_STATE", server_state, 1);
+        setenv("SIM_COMMAND_MS", "0", 1);
+    }
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    app_main();
+
+    UNITY_BEGIN();
+    if (boot == 0) {
+        RUN_TEST(test_cold_boot_waits_for_the_server);
+        RUN_TEST(test_drop_reconnects_through_cached_ap);
+        RUN_TEST(test_outage_falls_back_to_full_scan);
+        // Второй запуск продолжает вывод тех же тестов после перезагрузки
+        vTaskDelay(pdMS_TO_TICKS(SNAPSHOT_WAIT_MS));
+        if (Unity.TestFailures == 0) sim_reboot();
+        return UNITY_END();
+    }
+    RUN_TEST(test_snapshot_boot_actuates_before_wifi);
+    unlink(getenv("SIM_NVS_PATH"));
+    return UNITY_END();
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "devices.h"
+#include "hal.h"
+#include "sim.h"
+
+/* Бенчмарк управляющего цикла прошивки с порогами: app_main на hal_linux.c, команды
+ * в комнату 0 "сервера" подаёт тест вместо sim_driver (SIM_COMMAND_MS=0), замеры
+ * те же, что в отчёте симуляции (sim_stats_take). Пороги с запасом в разы от
+ * замеренного, чтобы ловить регрессии, а не шум хоста. */
+
+#define COMMANDS          50
+#define COMMAND_GAP_MAX_MS 200
+#define WAIT_MS           2000
+#define P99_MAX_US        50000 // Long-poll: сеть HAL_SIM_RTT_MS туда и обратно и разбор
+#define MAX_MAX_US        100000
+#define CYCLE_CPU_MAX_NS  200000
+#define HEAP_PEAK_MAX     16384 // Вся куча процесса вместе с заглушкой сервера
+
+void app_main(void);
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static bool wait_relay(int id, bool on) {
+    for (int waited = 0; waited < WAIT_MS; waited++) {
+        if (sim_output_get(g_devices[id].pin) == on) return true;
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    return false;
+}
+
+static void test_control_loop_within_bounds(void) {
+    sim_stats stats;
+    sim_heap heap;
+    bool state[DEVICE_MAX] = {0};
+
+    sim_stats_take(&stats);
+    sim_heap_stats(&heap);
+    for (int i = 0; i < COMMANDS; i++) {
+        // Только устройства без пауз min_on/min_off и автоотключения: задержка - это цикл, а не планировщик
+        int id;
+        do id = rand() % g_device_count;
+        while (g_devices[id].timing.min_on_ms || g_devices[id].timing.min_off_ms || g_devices[id].timing.auto_off_ms);
+
+        vTaskDelay(pdMS_TO_TICKS(rand() % COMMAND_GAP_MAX_MS));
+        state[id] = !state[id];
+        sim_server_command(0, id, state[id]);
+        TEST_ASSERT_TRUE_MESSAGE(wait_relay(id, state[id]), "relay did not follow the command");
+    }
+    sim_stats_take(&stats);
+    sim_heap_stats(&heap);
+
+    char message[192];
+    snprintf(message, sizeof(message),
+             "%u commands: command-to-actuation p50 %lld us, p99 %lld us, max %lld us; %llu cycles, "
+             "CPU %llu ns and %.2f allocations per cycle; heap peak %lld bytes",
+             (unsigned) stats.commands, (long long) stats.propagation_p50_us, (long long) stats.propagation_p99_us,
+             (long long) stats.propagation_max_us, (unsigned long long) stats.cycles,
+             (unsigned long long) stats.cycle_cpu_ns, stats.cycle_allocs, (long long) heap.peak);
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_EQUAL_UINT32(COMMANDS, stats.commands);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(P99_MAX_US, stats.propagation_p99_us);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(MAX_MAX_US, stats.propagation_max_us);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT64(COMMANDS, stats.cycles);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT64(CYCLE_CPU_MAX_NS, stats.cycle_cpu_ns);
+    TEST_ASSERT_TRUE_MESSAGE(stats.cycle_allocs == 0.0, "the control loop allocates");
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(HEAP_PEAK_MAX, heap.peak);
+}
+
+int main(void) {
+    setenv("SIM_COMMAND_MS", "0", 1);
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    app_main();
+    // Первое состояние и переход на long-poll - до замера
+    hal_wifi_wait_connected(UINT32_MAX);
+    vTaskDelay(pdMS_TO_TICKS(1000));
+
+    UNITY_BEGIN();
+    RUN_TEST(test_control_loop_within_bounds);
+    return UNITY_END();
+}
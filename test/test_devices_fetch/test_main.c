@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "devices.h"
+#include "controller_config.h"
+#include "hal.h"
+#include "sim.h"
+
+/* Опрос состояний устройств в хостовой сборке прошивки против заглушки сервера.
+ * Заглушка не держит long-poll (SIM_SERVER_PUSH=0), так что клиент откатывается на
+ * опрос раз в POLL_PERIOD_MS. До пакетного запроса было четыре задачи по 4 КБ стека,
+ * каждая с запросом в секунду и телом ответа каждый раз; теперь одна задача и один
+ * запрос на все устройства, а неизменное состояние - 304 без тела. */
+
+#define WINDOW_MS        5000
+#define WAIT_MS          5000
+#define STACK_FREE_MIN   2048 // Из DEVICES_TASK_STACK * IDF_HOST_STACK_SCALE на хосте
+#define HEAP_PEAK_MAX    16384 // Вся куча процесса вместе с заглушкой сервера
+#define SERVER_STATE     0x5  // Устройства 0 и 2 включены
+
+void app_main(void);
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static bool wait_relay(int id, bool on) {
+    for (int waited = 0; waited < WAIT_MS; waited++) {
+        if (sim_output_get(g_devices[id].pin) == on) return true;
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    return false;
+}
+
+static void test_first_state_in_one_body(void) {
+    sim_room_stats stats;
+
+    for (int i = 0; i < g_device_count; i++) {
+        TEST_ASSERT_TRUE_MESSAGE(wait_relay(i, SERVER_STATE & (1 << i)), "relay does not follow the server state");
+    }
+    sim_server_room_stats(0, &stats);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.bodies);
+}
+
+static void test_unchanged_state_costs_one_304_per_period(void) {
+    sim_room_stats before, after;
+    sim_heap heap_before, heap_after;
+
+    // Откат на опрос уже случился: первый ответ без long-poll был 304 сразу
+    sim_server_room_stats(0, &before);
+    sim_heap_stats(&heap_before);
+    vTaskDelay(pdMS_TO_TICKS(WINDOW_MS));
+    sim_server_room_stats(0, &after);
+    sim_heap_stats(&heap_after);
+
+    uint32_t requests = after.requests - before.requests;
+    uint32_t per_device_requests = g_device_count * WINDOW_MS / POLL_PERIOD_MS;
+    char message[144];
+    snprintf(message, sizeof(message),
+             "%u requests in %d ms for %d devices (%u with a task per device), heap peak since start %lld bytes",
+             (unsigned) requests, WINDOW_MS, g_device_count, (unsigned) per_device_requests,
+             (long long) heap_before.peak);
+    TEST_MESSAGE(message);
+
+    // Один запрос на все устройства за период: в g_device_count раз меньше, чем по задаче на устройство
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(WINDOW_MS / POLL_PERIOD_MS - 1, requests);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(WINDOW_MS / POLL_PERIOD_MS + 1, requests);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(per_device_requests + g_device_count, requests * g_device_count);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(per_device_requests - g_device_count, requests * g_device_count);
+    TEST_ASSERT_EQUAL_UINT32(requests, after.not_modified - before.not_modified);
+    TEST_ASSERT_EQUAL_UINT32(0, after.bodies - before.bodies);
+
+    // Ни одного выделения памяти на запрос: клиент и разбор работают в своих буферах
+    TEST_ASSERT_EQUAL_UINT64(0, heap_after.allocs - heap_before.allocs);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(heap_before.used, heap_after.peak);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(HEAP_PEAK_MAX, heap_before.peak);
+}
+
+static void test_aligned_allocations_are_counted(void) {
+    sim_heap before, allocated, freed;
+    void *blocks[3];
+
+    sim_heap_stats(&before);
+    blocks[0] = aligned_alloc(64, 256);
+    TEST_ASSERT_EQUAL(0, posix_memalign(&blocks[1], 64, 256));
+    blocks[2] = memalign(64, 256);
+    sim_heap_stats(&allocated);
+    for (int i = 0; i < 3; i++) free(blocks[i]);
+    sim_heap_stats(&freed);
+
+    // Учёт кучи видит и выровненные выделения, иначе free() уводил бы used в минус
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT64(3, allocated.allocs - before.allocs);
+    TEST_ASSERT_GREATER_OR_EQUAL_INT64(before.used + 3 * 256, allocated.used);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(allocated.used - 3 * 256, freed.used);
+}
+
+static void test_command_costs_one_body(void) {
+    sim_room_stats before, after;
+
+    sim_server_room_stats(0, &before);
+    sim_server_command(0, 1, true);
+    TEST_ASSERT_TRUE(wait_relay(1, true));
+    sim_server_room_stats(0, &after);
+
+    TEST_ASSERT_EQUAL_UINT32(1, after.bodies - before.bodies);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(2, after.requests - before.requests);
+}
+
+static void test_single_task_stack_high_water(void) {
+    TaskHandle_t task = xTaskGetHandle("devices_task");
+    TEST_ASSERT_NOT_NULL(task);
+
+    // На хосте в том же стеке работают заглушка сервера и snprintf из glibc, на плате расход меньше
+    UBaseType_t free_bytes = uxTaskGetStackHighWaterMark(task);
+    char message[64];
+    snprintf(message, sizeof(message), "devices_task stack: %u of %d host bytes free", (unsigned) free_bytes,
+             DEVICES_TASK_STACK * IDF_HOST_STACK_SCALE);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(STACK_FREE_MIN, free_bytes);
+}
+
+int main(void) {
+    char server_state[16];
+
+    snprintf(server_state, sizeof(server_state), "0x%x", SERVER_STATE);
+    setenv("SIM_SERVER_STATE", server_state, 1);
+    setenv("SIM_SERVER_PUSH", "0", 1);
+    setenv("SIM_COMMAND_MS", "0", 1);
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    app_main();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_first_state_in_one_body);
+    RUN_TEST(test_unchanged_state_costs_one_304_per_period);
+    RUN_TEST(test_aligned_allocations_are_counted);
+    RUN_TEST(test_command_costs_one_body);
+    RUN_TEST(test_single_task_stack_high_water);
+    return UNITY_END();
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "devices.h"
+#include "controller_config.h"
+#include "hal.h"
+#include "sim.h"
+
+/* Концевик в хостовой сборке прошивки: app_main с hal_linux.c, пин концевика
+ * переключает тест. Реле всех устройств включены с "сервера" (SIM_SERVER_STATE),
+ * sim_driver выключен (SIM_COMMAND_MS=0), так что реле меняются только от концевика. */
+
+#define TRIPS             50
+#define TRIP_LATENCY_MAX_US 10000 // Реле выключает задача концевика, а не тик планировщика (100 мс)
+#define WAIT_MS           2000
+#define BOUNCES           10
+#define IDLE_MS           2000
+#define IDLE_TASK_CPU_MAX_US 1000 // Задача концевика в покое не просыпается
+#define IDLE_CPU_MAX_PERMILLE 20  // Вся прошивка с заглушкой сервера в покое
+
+void app_main(void);
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static bool limit_relays_are(bool on) {
+    for (int i = 0; i < g_device_count; i++) {
+        if ((g_devices[i].safety_groups & DEVICE_GROUP_LIMIT_SWITCH) && sim_output_get(g_devices[i].pin) != on) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool wait_limit_relays(bool on, int timeout_ms) {
+    for (int waited = 0; waited < timeout_ms; waited++) {
+        if (limit_relays_are(on)) return true;
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    return limit_relays_are(on);
+}
+
+// Позднейшее переключение реле группы концевика
+static int64_t last_limit_relay_change_us(void) {
+    int64_t last_us = 0;
+
+    for (int i = 0; i < g_device_count; i++) {
+        int64_t changed_us = sim_output_changed_us(g_devices[i].pin);
+        if ((g_devices[i].safety_groups & DEVICE_GROUP_LIMIT_SWITCH) && changed_us > last_us) last_us = changed_us;
+    }
+    return last_us;
+}
+
+static uint32_t task_cpu_us(const char *name) {
+    TaskStatus_t tasks[32];
+    TaskHandle_t handle = xTaskGetHandle(name);
+    UBaseType_t count = uxTaskGetSystemState(tasks, 32, NULL);
+
+    TEST_ASSERT_NOT_NULL(handle);
+    for (UBaseType_t i = 0; i < count; i++) {
+        if (tasks[i].xHandle == handle) return tasks[i].ulRunTimeCounter;
+    }
+    TEST_FAIL_MESSAGE("task not found");
+    return 0;
+}
+
+static int64_t process_cpu_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static void test_relays_follow_server(void) {
+    TEST_ASSERT_TRUE_MESSAGE(wait_limit_relays(true, 5000), "relays did not turn on from the server state");
+}
+
+static void test_trip_turns_relays_off_within_bound(void) {
+    int64_t worst_us = 0;
+
+    for (int trip = 0; trip < TRIPS; trip++) {
+        // Фронт в разных фазах тика планировщика и опроса сервера
+        vTaskDelay(pdMS_TO_TICKS(rand() % 50));
+
+        int64_t edge_us = hal_time_us();
+        sim_input_set(LIMIT_SWITCH_PIN, LIMIT_SWITCH_ACTIVE_LEVEL);
+        TEST_ASSERT_TRUE_MESSAGE(wait_limit_relays(false, WAIT_MS), "relays stayed on after the trip");
+
+        int64_t latency_us = last_limit_relay_change_us() - edge_us;
+        if (latency_us > worst_us) worst_us = latency_us;
+
+        sim_input_set(LIMIT_SWITCH_PIN, !LIMIT_SWITCH_ACTIVE_LEVEL);
+        TEST_ASSERT_TRUE_MESSAGE(wait_limit_relays(true, WAIT_MS), "relays did not come back after the release");
+    }
+
+    char message[64];
+    snprintf(message, sizeof(message), "worst edge-to-relay-off latency %lld us", (long long) worst_us);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(TRIP_LATENCY_MAX_US, worst_us);
+}
+
+static void test_bouncing_release_keeps_relays_off(void) {
+    // Дребезг начинается в любой фазе окна антидребезга после срабатывания
+    for (int phase_ms = 0; phase_ms < LIMIT_DEBOUNCE_MS; phase_ms++) {
+        sim_input_set(LIMIT_SWITCH_PIN, LIMIT_SWITCH_ACTIVE_LEVEL);
+        TEST_ASSERT_TRUE(wait_limit_relays(false, WAIT_MS));
+        int64_t off_us = last_limit_relay_change_us();
+        vTaskDelay(pdMS_TO_TICKS(phase_ms));
+
+        /* Дребезг не должен снимать блокировку даже на миг. Период дребезга равен окну
+         * антидребезга - худший случай для сравнения уровня через LIMIT_DEBOUNCE_MS */
+        for (int i = 0; i < BOUNCES; i++) {
+            sim_input_set(LIMIT_SWITCH_PIN, !LIMIT_SWITCH_ACTIVE_LEVEL);
+            vTaskDelay(pdMS_TO_TICKS(LIMIT_DEBOUNCE_MS / 4));
+            sim_input_set(LIMIT_SWITCH_PIN, LIMIT_SWITCH_ACTIVE_LEVEL);
+            vTaskDelay(pdMS_TO_TICKS(LIMIT_DEBOUNCE_MS - LIMIT_DEBOUNCE_MS / 4));
+        }
+        char message[48];
+        snprintf(message, sizeof(message), "a bounce at phase %d ms released the lockout", phase_ms);
+        TEST_ASSERT_TRUE_MESSAGE(last_limit_relay_change_us() == off_us, message);
+
+        sim_input_set(LIMIT_SWITCH_PIN, !LIMIT_SWITCH_ACTIVE_LEVEL);
+        TEST_ASSERT_TRUE(wait_limit_relays(true, WAIT_MS));
+    }
+}
+
+static void test_idle_cpu_load(void) {
+    uint32_t task_before_us = task_cpu_us("limit_switch_task");
+    int64_t process_before_us = process_cpu_us();
+    int64_t started_us = hal_time_us();
+
+    vTaskDelay(pdMS_TO_TICKS(IDLE_MS));
+
+    uint32_t task_us = task_cpu_us("limit_switch_task") - task_before_us;
+    int64_t permille = (process_cpu_us() - process_before_us) * 1000 / (hal_time_us() - started_us);
+    char message[96];
+    snprintf(message, sizeof(message), "idle: limit switch task %u us CPU, whole firmware %lld permille",
+             (unsigned) task_us, (long long) permille);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(IDLE_TASK_CPU_MAX_US, task_us);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(IDLE_CPU_MAX_PERMILLE, permille);
+}
+
+int main(void) {
+    char server_state[24];
+
+    snprintf(server_state, sizeof(server_state), "0x%lx", (1UL << g_device_count) - 1);
+    setenv("SIM_SERVER_STATE", server_state, 1);
+    setenv("SIM_COMMAND_MS", "0", 1);
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    app_main();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_relays_follow_server);
+    RUN_TEST(test_trip_turns_relays_off_within_bound);
+    RUN_TEST(test_bouncing_release_keeps_relays_off);
+    RUN_TEST(test_idle_cpu_load);
+    return UNITY_END();
+}
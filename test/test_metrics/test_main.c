@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "unity.h"
+#include "esp_log.h"
+#include "actuator.h"
+#include "devices.h"
+#include "metrics.h"
+#include "hal.h"
+#include "sim.h"
+
+/* Метрики: запись зовётся из управляющего цикла и из критических секций планировщика,
+ * поэтому её цена ограничена сверху и без кучи. Страницу /metrics тест получает через
+ * sim_http_render(), как её отдал бы локальный HTTP-сервер. */
+
+#define RECORD_CALLS   1000000
+#define RECORD_NS_MAX  1000  // На вызов; атомарный инкремент на хосте - единицы нс
+#define PAGE_SIZE      16384
+#define LONG_HOLDS     150000 // По 30 с: в сумме больше 2^32 мс
+
+static actuator s_relays;
+static char s_page[PAGE_SIZE];
+static int s_page_len;
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void relay_output(void *ctx, int id, bool on) {}
+
+static void page_write(void *out, const char *text, int len) {
+    if (s_page_len + len >= PAGE_SIZE) len = PAGE_SIZE - 1 - s_page_len;
+    memcpy(s_page + s_page_len, text, len);
+    s_page_len += len;
+    s_page[s_page_len] = '\0';
+}
+
+static void render_page(void) {
+    s_page_len = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, sim_http_render(page_write, NULL));
+}
+
+static void assert_line(const char *line) {
+    TEST_ASSERT_NOT_NULL_MESSAGE(strstr(s_page, line), line);
+}
+
+static int64_t thread_cpu_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void test_records_land_in_their_series(void) {
+    for (int i = 0; i < 3; i++) metrics_record_request(METRICS_MODE_POLL, METRICS_RESULT_OK, 7);
+    for (int i = 0; i < 2; i++) metrics_record_request(METRICS_MODE_PUSH, METRICS_RESULT_NOT_MODIFIED, 20000);
+    for (int i = 0; i < 5; i++) metrics_record_toggle(1);
+    metrics_record_toggle(DEVICE_MAX); // Вне таблицы - пропускается
+    metrics_record_limit_trip();
+    render_page();
+
+    // Время ответа при опросе и удержание long-poll - разные гистограммы
+    assert_line("controller_http_request_duration_seconds_bucket{le=\"0.005\"} 0\n");
+    assert_line("controller_http_request_duration_seconds_bucket{le=\"0.010\"} 3\n");
+    assert_line("controller_http_request_duration_seconds_count 3\n");
+    assert_line("controller_long_poll_hold_seconds_bucket{le=\"10.000\"} 0\n");
+    assert_line("controller_long_poll_hold_seconds_bucket{le=\"35.000\"} 2\n");
+    assert_line("controller_long_poll_hold_seconds_sum 40.000\n");
+    assert_line("controller_http_requests_total{mode=\"poll\",result=\"ok\"} 3\n");
+    assert_line("controller_http_requests_total{mode=\"push\",result=\"not_modified\"} 2\n");
+    assert_line("controller_relay_toggles_total{device=\"humidifier\"} 5\n");
+    assert_line("controller_limit_switch_trips_total 1\n");
+    // Время CPU задач - счётчик для rate(), а не доля с загрузки
+    assert_line("# TYPE controller_task_cpu_seconds_total counter\n");
+}
+
+static void test_hold_sum_does_not_wrap(void) {
+    for (int i = 0; i < LONG_HOLDS; i++) metrics_record_request(METRICS_MODE_PUSH, METRICS_RESULT_NOT_MODIFIED, 30000);
+    render_page();
+
+    // 40 с из test_records_land_in_their_series и 4 500 000 с сейчас
+    assert_line("controller_long_poll_hold_seconds_sum 4500040.000\n");
+}
+
+static void test_record_cost_is_bounded(void) {
+    sim_heap before, after;
+
+    sim_heap_stats(&before);
+    int64_t started_ns = thread_cpu_ns();
+    for (int i = 0; i < RECORD_CALLS; i++) {
+        metrics_record_request(i % METRICS_MODE_COUNT, i % METRICS_RESULT_COUNT, i % 40000);
+        metrics_record_toggle(i % g_device_count);
+        metrics_record_limit_trip();
+    }
+    int64_t call_ns = (thread_cpu_ns() - started_ns) / (RECORD_CALLS * 3LL);
+    sim_heap_stats(&after);
+
+    char message[64];
+    snprintf(message, sizeof(message), "metrics_record_*: %lld ns per call", (long long) call_ns);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(RECORD_NS_MAX, call_ns);
+    TEST_ASSERT_EQUAL_UINT64(0, after.allocs - before.allocs);
+}
+
+int main(void) {
+    setenv("SIM_COMMAND_MS", "0", 1);
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    hal_init();
+    actuator_init(&s_relays, g_devices, g_device_count, relay_output, NULL);
+    metrics_start(&s_relays);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_records_land_in_their_series);
+    RUN_TEST(test_hold_sum_does_not_wrap);
+    RUN_TEST(test_record_cost_is_bounded);
+    return UNITY_END();
+}
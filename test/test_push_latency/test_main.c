@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "actuator.h"
+#include "devices.h"
+#include "controller_config.h"
+#include "devices_client.h"
+#include "hal.h"
+#include "sim.h"
+
+/* Push против опроса на заглушке сервера. Два клиента с настройками прошивки:
+ * комната 1 - long-poll (?wait=N), комната 2 - только опрос раз в POLL_PERIOD_MS.
+ * Одна и та же команда уходит в обе комнаты разом; задержка - от команды на
+ * сервере до переключения реле в планировщике клиента. */
+
+#define ROOM_PUSH        1
+#define ROOM_POLL        2
+#define ROOM_NO_ETAG     3    // Сервер без ETag, не держащий long-poll
+#define TEST_LONG_POLL_WAIT_S 2 // Удержание в тесте: окно простоя должно вмещать несколько
+#define COMMANDS         30
+#define COMMAND_GAP_MAX_MS 300
+#define WAIT_MS          3000
+#define IDLE_MS          3000
+#define PUSH_IDLE_MS     (5 * TEST_LONG_POLL_WAIT_S * 1000)
+#define DEVICE           0    // Вентилятор: без пауз min_on/min_off, команда применяется сразу
+#define PUSH_P50_MAX_US  50000
+#define PUSH_P99_MAX_US  100000
+#define POLL_P99_MAX_US  ((POLL_PERIOD_MS + 100) * 1000LL)
+
+typedef struct {
+    int room;
+    devices_client client;
+    actuator relays;
+    char url[DEVICES_CLIENT_URL_SIZE / 2];
+    volatile int64_t commanded_us;
+    volatile int64_t latency_us; // -1, пока команда не дошла до реле
+} room_client;
+
+static room_client s_rooms[3];
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void relay_output(void *ctx, int id, bool on) {
+    room_client *room = ctx;
+
+    if (id == DEVICE) room->latency_us = hal_time_us() - room->commanded_us;
+}
+
+static void on_states(void *ctx, uint32_t changed, uint32_t values) {
+    room_client *room = ctx;
+
+    for (int i = 0; i < g_device_count; i++) {
+        if (changed & (1UL << i)) actuator_request(&room->relays, i, values & (1UL << i));
+    }
+}
+
+static void start_client(room_client *room, int room_id, bool push) {
+    char name[16];
+
+    room->room = room_id;
+    snprintf(room->url, sizeof(room->url), SIM_SERVER_URL "/rooms/%d/devices", room_id);
+    room->client.config = (devices_client_config) {
+        .url = room->url,
+        .push = push,
+        .long_poll_wait_s = TEST_LONG_POLL_WAIT_S,
+        .poll_period_ms = POLL_PERIOD_MS,
+        .on_states = on_states,
+        .ctx = room
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, actuator_init(&room->relays, g_devices, g_device_count, relay_output, room));
+    snprintf(name, sizeof(name), "room_%d", room_id);
+    xTaskCreate(&devices_client_task, name, DEVICES_TASK_STACK, &room->client, 5, NULL);
+}
+
+static int compare_us(const void *a, const void *b) {
+    int64_t x = *(const int64_t *) a, y = *(const int64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static int64_t percentile(int64_t *samples, int count, int p) {
+    qsort(samples, count, sizeof(samples[0]), compare_us);
+    return samples[(count - 1) * p / 100];
+}
+
+static bool wait_latency(room_client *room) {
+    for (int waited = 0; waited < WAIT_MS; waited++) {
+        if (room->latency_us >= 0) return true;
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    return false;
+}
+
+static uint32_t messages_per_hour(uint32_t requests, int64_t window_us) {
+    return (uint32_t) (requests * 3600000000LL / window_us);
+}
+
+static void test_push_latency_below_polling(void) {
+    int64_t push_us[COMMANDS], poll_us[COMMANDS];
+    sim_room_stats push_before, poll_before, push_after, poll_after;
+
+    sim_server_room_stats(ROOM_PUSH, &push_before);
+    sim_server_room_stats(ROOM_POLL, &poll_before);
+    int64_t started_us = hal_time_us();
+
+    for (int i = 0; i < COMMANDS; i++) {
+        // Команды в разных фазах периода опроса
+        vTaskDelay(pdMS_TO_TICKS(rand() % COMMAND_GAP_MAX_MS));
+
+        for (int r = 0; r < 2; r++) {
+            s_rooms[r].latency_us = -1;
+            s_rooms[r].commanded_us = hal_time_us();
+            sim_server_command(s_rooms[r].room, DEVICE, i % 2 == 0);
+        }
+        TEST_ASSERT_TRUE_MESSAGE(wait_latency(&s_rooms[0]), "push client missed the command");
+        TEST_ASSERT_TRUE_MESSAGE(wait_latency(&s_rooms[1]), "polling client missed the command");
+        push_us[i] = s_rooms[0].latency_us;
+        poll_us[i] = s_rooms[1].latency_us;
+    }
+
+    int64_t window_us = hal_time_us() - started_us;
+    sim_server_room_stats(ROOM_PUSH, &push_after);
+    sim_server_room_stats(ROOM_POLL, &poll_after);
+
+    int64_t push_p50 = percentile(push_us, COMMANDS, 50), push_p99 = percentile(push_us, COMMANDS, 99);
+    int64_t poll_p50 = percentile(poll_us, COMMANDS, 50), poll_p99 = percentile(poll_us, COMMANDS, 99);
+    char message[192];
+    snprintf(message, sizeof(message),
+             "command-to-relay: push p50 %lld us p99 %lld us, poll p50 %lld us p99 %lld us; "
+             "messages per hour with commands: push %u, poll %u",
+             (long long) push_p50, (long long) push_p99, (long long) poll_p50, (long long) poll_p99,
+             (unsigned) messages_per_hour(push_after.requests - push_before.requests, window_us),
+             (unsigned) messages_per_hour(poll_after.requests - poll_before.requests, window_us));
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(PUSH_P50_MAX_US, push_p50);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(PUSH_P99_MAX_US, push_p99);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(POLL_P99_MAX_US, poll_p99);
+    TEST_ASSERT_TRUE_MESSAGE(push_p99 < poll_p50, "push is not faster than polling");
+
+    // На каждую команду push тратит один ответ с телом, а не запросы впустую
+    TEST_ASSERT_EQUAL_UINT32(COMMANDS, push_after.bodies - push_before.bodies);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(COMMANDS + 1, push_after.requests - push_before.requests);
+}
+
+static void test_idle_messages_per_hour(void) {
+    sim_room_stats push_before, poll_before, push_after, poll_after;
+
+    sim_server_room_stats(ROOM_PUSH, &push_before);
+    sim_server_room_stats(ROOM_POLL, &poll_before);
+    int64_t started_us = hal_time_us();
+    vTaskDelay(pdMS_TO_TICKS(PUSH_IDLE_MS));
+    int64_t window_us = hal_time_us() - started_us;
+    sim_server_room_stats(ROOM_PUSH, &push_after);
+    sim_server_room_stats(ROOM_POLL, &poll_after);
+
+    uint32_t push_requests = push_after.requests - push_before.requests;
+    uint32_t poll_requests = poll_after.requests - poll_before.requests;
+    uint32_t push_per_hour = messages_per_hour(push_requests, window_us);
+    char message[128];
+    snprintf(message, sizeof(message), "idle messages per hour: push %u with %d s hold (%u with %d s), poll %u",
+             (unsigned) push_per_hour, TEST_LONG_POLL_WAIT_S,
+             (unsigned) (push_per_hour * TEST_LONG_POLL_WAIT_S / LONG_POLL_WAIT_S), LONG_POLL_WAIT_S,
+             (unsigned) messages_per_hour(poll_requests, window_us));
+    TEST_MESSAGE(message);
+
+    // Без команд push - один запрос на удержание: 3600 / wait в час
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(PUSH_IDLE_MS / (TEST_LONG_POLL_WAIT_S * 1000) - 1, push_requests);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(PUSH_IDLE_MS / (TEST_LONG_POLL_WAIT_S * 1000) + 1, push_requests);
+    TEST_ASSERT_EQUAL_UINT32(push_requests, push_after.not_modified - push_before.not_modified);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(PUSH_IDLE_MS / POLL_PERIOD_MS - 1, poll_requests);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(PUSH_IDLE_MS / POLL_PERIOD_MS + 1, poll_requests);
+}
+
+static void test_server_without_etag_falls_back_to_polling(void) {
+    sim_room_stats before, after;
+
+    sim_server_room_etag(ROOM_NO_ETAG, false);
+    start_client(&s_rooms[2], ROOM_NO_ETAG, true);
+    vTaskDelay(pdMS_TO_TICKS(POLL_PERIOD_MS));
+
+    sim_server_room_stats(ROOM_NO_ETAG, &before);
+    vTaskDelay(pdMS_TO_TICKS(IDLE_MS));
+    sim_server_room_stats(ROOM_NO_ETAG, &after);
+
+    // Каждый ответ - тело, но запросы идут раз в период опроса, а не подряд
+    uint32_t requests = after.requests - before.requests;
+    TEST_ASSERT_EQUAL_UINT32(requests, after.bodies - before.bodies);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(IDLE_MS / POLL_PERIOD_MS + 1, requests);
+}
+
+int main(void) {
+    setenv("SIM_SERVER_ROOMS", "3", 1);
+    setenv("SIM_COMMAND_MS", "0", 1);
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    hal_init();
+    hal_wifi_start("", "");
+
+    UNITY_BEGIN();
+    start_client(&s_rooms[0], ROOM_PUSH, true);
+    start_client(&s_rooms[1], ROOM_POLL, false);
+    // Первые ответы с начальным состоянием приходят после подключения Wi-Fi
+    hal_wifi_wait_connected(UINT32_MAX);
+    vTaskDelay(pdMS_TO_TICKS(POLL_PERIOD_MS * 2));
+
+    RUN_TEST(test_push_latency_below_polling);
+    RUN_TEST(test_idle_messages_per_hour);
+    RUN_TEST(test_server_without_etag_falls_back_to_polling);
+    return UNITY_END();
+}
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "unity.h"
+#include "devices.h"
+#include "state_parser.h"
+#include "sim.h"
+
+/* Потоковый разбор ответа GET /devices. Результат не должен зависеть от того, где
+ * HTTP-клиент разрезал тело: каждый ответ проверяется на всех разрезах на два и три
+ * куска, а случайные ответы - против простого эталона, который разбирает тело целиком
+ * по строкам. Разбор не трогает кучу (счётчик выделений hal_linux.c). */
+
+#define FUZZ_BODIES        20000
+#define BODY_MAX           256
+#define THROUGHPUT_BODIES  100000
+#define THROUGHPUT_CHUNK   16     // HAL_SIM_CHUNK в hal_linux.c
+#define BODY_NS_MAX        20000  // Ответ на все устройства; на хосте в разы быстрее
+
+typedef struct {
+    esp_err_t err;
+    uint32_t seen;
+    uint32_t values;
+} parse_result;
+
+static const char *s_bodies[] = {
+    "fan=1\nhumidifier=0\nfreshener=1\nfreshener2=0\n",
+    "fan=1\r\nhumidifier=1\r\n",
+    "\n\r\nfan=0\n\nfreshener2=1",
+    "fan=1\nfan=0\n",
+    "freshener=1\nunknown=1\nfresh=0\nfreshener22=1\n",
+    "",
+    "fan=1\nhumidifier=",
+    "fan=2\n",
+    "fan 1\n",
+    "=1\n",
+    "fan=1x\n",
+    "fan=1\rx\n",
+    "a_very_long_device_name_over_the_limit=1\n",
+};
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static parse_result parse_chunks(const char *body, int len, const int *cuts, int cut_count) {
+    state_parser parser;
+    parse_result result = {ESP_OK};
+    int off = 0;
+
+    state_parser_reset(&parser);
+    for (int i = 0; i <= cut_count; i++) {
+        int end = i < cut_count ? cuts[i] : len;
+        esp_err_t err = state_parser_feed(&parser, body + off, end - off);
+        if (err != ESP_OK) result.err = err;
+        off = end;
+    }
+    if (result.err == ESP_OK) result.err = state_parser_finish(&parser);
+    result.seen = parser.seen;
+    result.values = parser.values;
+    return result;
+}
+
+static bool is_name_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+}
+
+// Эталон: тело целиком, по строкам, имена сравниваются strcmp
+static parse_result parse_reference(const char *body, int len) {
+    parse_result result = {ESP_OK};
+
+    for (int start = 0; start <= len; ) {
+        int end = start;
+        while (end < len && body[end] != '\n') end++;
+
+        int p = start;
+        while (p < end && body[p] == '\r') p++;
+        if (p < end) {
+            int name = p;
+            while (p < end && is_name_char(body[p])) p++;
+            int name_len = p - name;
+            if (name_len == 0 || name_len > 32 || p + 1 >= end || body[p] != '=' ||
+                (body[p + 1] != '0' && body[p + 1] != '1')) {
+                result.err = ESP_ERR_INVALID_RESPONSE;
+                return result;
+            }
+            bool on = body[p + 1] == '1';
+            for (p += 2; p < end; p++) {
+                if (body[p] != '\r') {
+                    result.err = ESP_ERR_INVALID_RESPONSE;
+                    return result;
+                }
+            }
+            for (int i = 0; i < g_device_count; i++) {
+                if (strlen(g_devices[i].id) == (size_t) name_len && !memcmp(g_devices[i].id, body + name, name_len)) {
+                    result.seen |= 1UL << i;
+                    if (on) result.values |= 1UL << i;
+                    else result.values &= ~(1UL << i);
+                }
+            }
+        }
+        start = end + 1;
+    }
+    return result;
+}
+
+static void assert_same(const parse_result *expected, const parse_result *actual, const char *body) {
+    TEST_ASSERT_EQUAL_MESSAGE(expected->err, actual->err, body);
+    if (expected->err != ESP_OK) return;
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected->seen, actual->seen, body);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected->values, actual->values, body);
+}
+
+static void test_every_split_gives_the_same_result(void) {
+    for (size_t b = 0; b < sizeof(s_bodies) / sizeof(s_bodies[0]); b++) {
+        const char *body = s_bodies[b];
+        int len = strlen(body);
+        parse_result expected = parse_reference(body, len);
+        parse_result whole = parse_chunks(body, len, NULL, 0);
+
+        assert_same(&expected, &whole, body);
+        for (int i = 0; i <= len; i++) {
+            for (int j = i; j <= len; j++) {
+                int cuts[2] = {i, j};
+                parse_result split = parse_chunks(body, len, cuts, 2);
+                assert_same(&expected, &split, body);
+            }
+        }
+    }
+}
+
+static int random_body(unsigned int *seed, char *body) {
+    static const char *names[] = {"fan", "humidifier", "freshener", "freshener2", "fresh", "fanx", "unknown", "f", ""};
+    static const char *ends[] = {"\n", "\r\n", "\n\n", "\r\r\n", ""};
+    int len = 0;
+
+    for (int lines = rand_r(seed) % 6; lines > 0 && len < BODY_MAX - 48; lines--) {
+        len += snprintf(body + len, BODY_MAX - len, "%s=%c%s", names[rand_r(seed) % 9], "01"[rand_r(seed) % 2],
+                        ends[rand_r(seed) % 5]);
+    }
+    // Порча: случайный байт в случайном месте
+    for (int n = rand_r(seed) % 3; n > 0 && len > 0; n--) body[rand_r(seed) % len] = " =01\r\nfx2"[rand_r(seed) % 9];
+    body[len] = '\0';
+    return len;
+}
+
+static void test_fuzz_against_reference(void) {
+    unsigned int seed = 1;
+    char body[BODY_MAX];
+    int cuts[4];
+
+    for (int n = 0; n < FUZZ_BODIES; n++) {
+        int len = random_body(&seed, body);
+        int cut_count = rand_r(&seed) % 5;
+
+        for (int i = 0; i < cut_count; i++) cuts[i] = len ? rand_r(&seed) % (len + 1) : 0;
+        for (int i = 1; i < cut_count; i++) {
+            for (int k = i; k > 0 && cuts[k - 1] > cuts[k]; k--) {
+                int tmp = cuts[k];
+                cuts[k] = cuts[k - 1];
+                cuts[k - 1] = tmp;
+            }
+        }
+        parse_result expected = parse_reference(body, len);
+        parse_result actual = parse_chunks(body, len, cuts, cut_count);
+        assert_same(&expected, &actual, body);
+    }
+}
+
+static void test_no_allocations_and_throughput(void) {
+    const char *body = s_bodies[0];
+    int len = strlen(body);
+    state_parser parser;
+    sim_heap before, after;
+    struct timespec started, finished;
+
+    sim_heap_stats(&before);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &started);
+    for (int n = 0; n < THROUGHPUT_BODIES; n++) {
+        state_parser_reset(&parser);
+        for (int off = 0; off < len; off += THROUGHPUT_CHUNK) {
+            state_parser_feed(&parser, body + off, len - off < THROUGHPUT_CHUNK ? len - off : THROUGHPUT_CHUNK);
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, state_parser_finish(&parser));
+    }
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &finished);
+    sim_heap_stats(&after);
+
+    int64_t ns = (finished.tv_sec - started.tv_sec) * 1000000000LL + finished.tv_nsec - started.tv_nsec;
+    int64_t body_ns = ns / THROUGHPUT_BODIES;
+    char message[96];
+    snprintf(message, sizeof(message), "%d-byte body in %d-byte chunks: %lld ns, %lld MB/s",
+             len, THROUGHPUT_CHUNK, (long long) body_ns, (long long) (len * 1000LL / (body_ns + 1)));
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_EQUAL_UINT64(0, after.allocs - before.allocs);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(BODY_NS_MAX, body_ns);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_every_split_gives_the_same_result);
+    RUN_TEST(test_fuzz_against_reference);
+    RUN_TEST(test_no_allocations_and_throughput);
+    return UNITY_END();
+}